@@ -0,0 +1,225 @@
+/**
+ * Headless render benchmark: renders a fixed set of views at several
+ * resolutions, without any GPIO/SPI code, and reports throughput as a text
+ * table or as JSON. Each view is drawn as given, then followed by one frame
+ * zoomed on from it, which is where the search and its retries come in.
+ *
+ * --gray renders the 4-level gray image as well and --dither dithers
+ * the 1bpp frame, for comparing their cost with the plain 1bpp frame.
+ * --antialias 4|16 supersamples the boundary pixels of either, on a rotated
+ * grid or, with --jitter, on a jittered one. --distance P draws black what
+ * the distance estimate puts within P pixels of the set, which changes the
+ * black share and with it the retries. --formula renders another fractal
+ * than the Mandelbrot set, from its own starting view instead of the views
+ * below.
+ *
+ * A view whose frame comes out all black or all white is flagged, since its
+ * time then measures the fill rather than the iteration.
+ *
+ *   bench_render [--json] [--gray] [--dither fs|atkinson|sierra|bayer|bluenoise] [--antialias N] [--jitter] [--distance P] [--formula mandelbrot|multibrot3|multibrot4|tricorn|burningship|julia] [--repeat N] [--seed N] [--resolution WxH]...
+**/
+#include "mandelbrot.hpp"
+#include "GUI_Paint.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchView {
+	const char * name;
+	double centerX;
+	double centerY;
+	double width;
+};
+
+struct BenchResolution {
+	int width;
+	int height;
+};
+
+struct BenchResult {
+	const BenchView * view;
+	BenchResolution resolution;
+	double seconds;
+	RenderStats stats;
+	double utilization;
+	FrameInfo frame;
+	// The frame zoomed on from the view.
+	double zoomSeconds;
+	int zoomRetries;
+};
+
+static const BenchView Views[] = {
+	{"shallow", -0.75, 0.0, 3.0},
+	{"1e-6", -0.743643887037151, 0.131825904205330, 1e-6},
+	{"1e-12", -0.88812039176957747, 0.22700831529151633, 1e-12},
+	{"interior", -0.15, 0.0, 1.0},
+	{"exterior", 0.28, 0.0, 0.1},
+};
+
+// Width 0: the starting view of the formula, for fractals other than the
+// Mandelbrot set.
+static const BenchView StartView = {"start", 0.0, 0.0, 0.0};
+
+/**
+ * Best of repeat renders of one view, each by a fresh MandelbrotSet so that
+ * no frame reuses the previous one. The zoomed frame is timed separately,
+ * also best of repeat.
+**/
+static BenchResult RunView(const BenchView & view, BenchResolution resolution, int repeat, uint64_t seed, bool gray, DitherMode dither, int antialias, SamplePattern pattern, double distance, FractalFormula formula) {
+	int pixelsPerByte = gray ? 4 : 8;
+	std::vector < UBYTE > image((resolution.width + pixelsPerByte - 1) / pixelsPerByte * resolution.height);
+	Paint_NewImage(image.data(), resolution.width, resolution.height, 0, WHITE);
+	Paint_SelectImage(image.data());
+	if(gray) {
+		Paint_SetScale(4);
+	}
+	BenchResult best = {};
+	best.view = & view;
+	best.resolution = resolution;
+	for(int run = 0; run < repeat; ++run) {
+		MandelbrotSet mandelbrot;
+		mandelbrot.SetFormula(formula);
+		mandelbrot.InitMandelbrotSet();
+		mandelbrot.SetSeed(seed);
+		mandelbrot.SetRender(image.data());
+		mandelbrot.SetRenderMode(RenderSubdivision);
+		mandelbrot.SetShadeMode(gray ? ShadeGray4 : ShadeBlackWhite);
+		mandelbrot.SetDitherMode(dither);
+		mandelbrot.SetAntialiasing(antialias, pattern);
+		mandelbrot.SetDistanceEstimation(distance);
+		if(view.width > 0.0) {
+			mandelbrot.SetView(view.centerX, view.centerY, view.width);
+		} else {
+			FrameInfo start = mandelbrot.GetFrameInfo();
+			mandelbrot.SetView(start.centerX, start.centerY, start.width);
+		}
+		// Render's progress log would swamp the report.
+		std::streambuf * console = std::cout.rdbuf(nullptr);
+		auto start = std::chrono::steady_clock::now();
+		mandelbrot.Render(resolution.width, resolution.height);
+		auto end = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration < double > (end - start).count();
+		if(run == 0 || seconds < best.seconds) {
+			best.seconds = seconds;
+			best.stats = mandelbrot.GetRenderStats();
+			best.utilization = mandelbrot.GetThreadUtilization();
+			best.frame = mandelbrot.GetFrameInfo();
+		}
+		start = std::chrono::steady_clock::now();
+		mandelbrot.Render(resolution.width, resolution.height);
+		end = std::chrono::steady_clock::now();
+		std::cout.rdbuf(console);
+		seconds = std::chrono::duration < double > (end - start).count();
+		if(run == 0 || seconds < best.zoomSeconds) {
+			best.zoomSeconds = seconds;
+			best.zoomRetries = mandelbrot.GetRetries();
+		}
+	}
+	return best;
+}
+
+static double Megapixels(const BenchResult & result) {
+	return (double) result.resolution.width * result.resolution.height / result.seconds / 1e6;
+}
+
+static double Iterations(const BenchResult & result) {
+	return (double) result.stats.iterations / result.seconds;
+}
+
+static bool Uniform(const BenchResult & result) {
+	return result.frame.blackRatio <= 0.0 || result.frame.blackRatio >= 1.0;
+}
+
+static void PrintText(const std::vector < BenchResult > & results, unsigned threads, bool gray, DitherMode dither, FractalFormula formula) {
+	printf("%u render threads, %s kernel, %s, %s, dither %s\n", threads, EscapeKernel::Backend(), FormulaName(formula), gray ? "4-level gray" : "black and white", DitherModeName(dither));
+	printf("%-9s %-10s %9s %9s %11s %6s %6s %6s %9s %7s\n", "view", "resolution", "time ms", "Mpx/s", "Giter/s", "util", "black", "iter", "zoom ms", "retries");
+	bool uniform = false;
+	for(const auto & result: results) {
+		char resolution[24];
+		snprintf(resolution, sizeof(resolution), "%dx%d", result.resolution.width, result.resolution.height);
+		printf("%-9s %-10s %9.2f %9.2f %11.3f %5.1f%% %5.1f%% %6d %9.2f %7d%s\n", result.view->name, resolution, result.seconds * 1000.0, Megapixels(result), Iterations(result) / 1e9, result.utilization * 100.0, result.frame.blackRatio * 100.0, result.frame.iterations, result.zoomSeconds * 1000.0, result.zoomRetries, Uniform(result) ? " *" : "");
+		uniform = uniform || Uniform(result);
+	}
+	if(uniform) {
+		printf("* all black or all white: the time is that of the fill, not of iterating\n");
+	}
+}
+
+static void PrintJson(const std::vector < BenchResult > & results, unsigned threads, uint64_t seed, bool gray, DitherMode dither, FractalFormula formula) {
+	printf("{\n  \"threads\": %u,\n  \"backend\": \"%s\",\n  \"seed\": %llu,\n  \"formula\": \"%s\",\n  \"gray\": %s,\n  \"dither\": \"%s\",\n  \"results\": [\n", threads, EscapeKernel::Backend(), (unsigned long long) seed, FormulaName(formula), gray ? "true" : "false", DitherModeName(dither));
+	for(size_t k = 0; k < results.size(); ++k) {
+		const BenchResult & result = results[k];
+		printf("    {\"view\": \"%s\", \"width\": %d, \"height\": %d, \"seconds\": %.6f, \"megapixelsPerSecond\": %.4f, \"iterationsPerSecond\": %.0f, ", result.view->name, result.resolution.width, result.resolution.height, result.seconds, Megapixels(result), Iterations(result));
+		printf("\"threadUtilization\": %.4f, \"pixelsIterated\": %llu, \"pixelsFilled\": %llu, \"blackRatio\": %.4f, \"iterationLimit\": %d, ", result.utilization, result.stats.pixelsIterated, result.stats.pixelsFilled, result.frame.blackRatio, result.frame.iterations);
+		printf("\"uniform\": %s, \"zoomSeconds\": %.6f, \"retries\": %d}%s\n", Uniform(result) ? "true" : "false", result.zoomSeconds, result.zoomRetries, k + 1 < results.size() ? "," : "");
+	}
+	printf("  ]\n}\n");
+}
+
+int main(int argc, char * argv[]) {
+	bool json = false;
+	bool gray = false;
+	DitherMode dither = DitherNone;
+	int antialias = 1;
+	SamplePattern pattern = SampleRotatedGrid;
+	double distance = 0.0;
+	FractalFormula formula = FormulaMandelbrot;
+	int repeat = 3;
+	uint64_t seed = 1;
+	std::vector < BenchResolution > resolutions;
+	for(int arg = 1; arg < argc; ++arg) {
+		BenchResolution resolution;
+		if(strcmp(argv[arg], "--json") == 0) {
+			json = true;
+		} else if(strcmp(argv[arg], "--gray") == 0) {
+			gray = true;
+		} else if(strcmp(argv[arg], "--dither") == 0 && arg + 1 < argc && ParseDitherMode(argv[++arg], dither)) {
+		} else if(strcmp(argv[arg], "--antialias") == 0 && arg + 1 < argc) {
+			antialias = atoi(argv[++arg]);
+		} else if(strcmp(argv[arg], "--jitter") == 0) {
+			pattern = SampleJittered;
+		} else if(strcmp(argv[arg], "--distance") == 0 && arg + 1 < argc) {
+			distance = atof(argv[++arg]);
+		} else if(strcmp(argv[arg], "--formula") == 0 && arg + 1 < argc && ParseFormula(argv[++arg], formula)) {
+		} else if(strcmp(argv[arg], "--repeat") == 0 && arg + 1 < argc) {
+			repeat = std::max(1, atoi(argv[++arg]));
+		} else if(strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+			seed = strtoull(argv[++arg], nullptr, 0);
+		} else if(strcmp(argv[arg], "--resolution") == 0 && arg + 1 < argc && sscanf(argv[++arg], "%dx%d", & resolution.width, & resolution.height) == 2 && resolution.width > 0 && resolution.height > 0) {
+			resolutions.push_back(resolution);
+		} else {
+			fprintf(stderr, "Usage: %s [--json] [--gray] [--dither fs|atkinson|sierra|bayer|bluenoise] [--antialias N] [--jitter] [--distance P] [--formula mandelbrot|multibrot3|multibrot4|tricorn|burningship|julia] [--repeat N] [--seed N] [--resolution WxH]...\n", argv[0]);
+			return 1;
+		}
+	}
+	if(resolutions.empty()) {
+		resolutions = {{800, 480}, {400, 240}, {1600, 960}};
+	}
+	std::vector < const BenchView * > views;
+	if(formula == FormulaMandelbrot) {
+		for(const auto & view: Views) {
+			views.push_back(& view);
+		}
+	} else {
+		views.push_back(& StartView);
+	}
+	std::vector < BenchResult > results;
+	for(const auto & resolution: resolutions) {
+		for(const BenchView * view: views) {
+			results.push_back(RunView(* view, resolution, repeat, seed, gray, dither, antialias, pattern, distance, formula));
+		}
+	}
+	unsigned threads = MandelbrotSet().GetThreadCount();
+	if(json) {
+		PrintJson(results, threads, seed, gray, dither, formula);
+	} else {
+		PrintText(results, threads, gray, dither, formula);
+	}
+	return 0;
+}
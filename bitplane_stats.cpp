@@ -0,0 +1,116 @@
+#include "bitplane_stats.hpp"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Eight bytes of a row starting at byte, as a word whose most significant bit
+ * is the first pixel. Bytes past the end of the row read as white.
+**/
+static inline uint64_t LoadWord(const UBYTE * row, int byte, int widthByte) {
+	uint64_t word = ~0ull;
+	memcpy( & word, row + byte, std::min(8, widthByte - byte));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	word = __builtin_bswap64(word);
+#endif
+	return word;
+}
+
+long BitplaneStats::CountBlack(const UBYTE * image, int widthByte, int x0, int y0, int x1, int y1) {
+	if(x1 <= x0 || y1 <= y0) {
+		return 0;
+	}
+	long black = 0;
+	int firstWord = x0 / 64;
+	int lastWord = (x1 - 1) / 64;
+	for(int y = y0; y < y1; ++y) {
+		const UBYTE * row = image + y * widthByte;
+		for(int w = firstWord; w <= lastWord; ++w) {
+			int a = std::max(x0 - w * 64, 0);
+			int b = std::min(x1 - w * 64, 64);
+			uint64_t mask = (~0ull >> a) & (b == 64 ? ~0ull : ~(~0ull >> b));
+			black += __builtin_popcountll(~LoadWord(row, w * 8, widthByte) & mask);
+		}
+	}
+	return black;
+}
+
+void BitplaneStats::MarkEdges(const UBYTE * image, int widthByte, int width, int height, UBYTE * edges) {
+	for(int y = 0; y < height; ++y) {
+		const UBYTE * row = image + y * widthByte;
+		const UBYTE * below = y + 1 < height ? row + widthByte : row;
+		UBYTE * out = edges + y * widthByte;
+		for(int b = 0; b < widthByte; ++b) {
+			// Pixels of this byte that are real and have a right neighbour.
+			int first = b * 8;
+			int pixels = std::min(8, width - first);
+			UBYTE valid = (UBYTE)(0xFF << (8 - pixels));
+			UBYTE hasRight = first + 8 < width ? 0xFF : (UBYTE)(valid << 1);
+			UBYTE next = b + 1 < widthByte ? row[b + 1] : 0xFF;
+			UBYTE right = (UBYTE)(row[b] << 1 | next >> 7);
+			UBYTE diff = ((row[b] ^ right) & hasRight) | ((row[b] ^ below[b]) & valid);
+			out[b] = (UBYTE) ~diff;
+		}
+	}
+}
+
+void BitplaneStats::MarkMixed(const UBYTE * image, int widthByte, int width, int height, UBYTE * mixed) {
+	// Per byte of a row: pixels with a black or a white pixel in their column
+	// of three. Padding bits count as neither.
+	std::vector < UBYTE > black(widthByte), white(widthByte);
+	UBYTE lastMask = width % 8 ? (UBYTE)(0xFF << (8 - width % 8)) : 0xFF;
+	for(int y = 0; y < height; ++y) {
+		const UBYTE * row = image + y * widthByte;
+		const UBYTE * above = y > 0 ? row - widthByte : row;
+		const UBYTE * below = y + 1 < height ? row + widthByte : row;
+		for(int b = 0; b < widthByte; ++b) {
+			UBYTE valid = b == widthByte - 1 ? lastMask : 0xFF;
+			white[b] = (above[b] | row[b] | below[b]) & valid;
+			black[b] = ~(above[b] & row[b] & below[b]) & valid;
+		}
+		UBYTE * out = mixed + y * widthByte;
+		for(int b = 0; b < widthByte; ++b) {
+			UBYTE previousBlack = b > 0 ? black[b - 1] : 0, nextBlack = b + 1 < widthByte ? black[b + 1] : 0;
+			UBYTE previousWhite = b > 0 ? white[b - 1] : 0, nextWhite = b + 1 < widthByte ? white[b + 1] : 0;
+			UBYTE anyBlack = black[b] | (UBYTE)(black[b] << 1 | nextBlack >> 7) | (UBYTE)(black[b] >> 1 | previousBlack << 7);
+			UBYTE anyWhite = white[b] | (UBYTE)(white[b] << 1 | nextWhite >> 7) | (UBYTE)(white[b] >> 1 | previousWhite << 7);
+			UBYTE valid = b == widthByte - 1 ? lastMask : 0xFF;
+			out[b] = (UBYTE) ~(anyBlack & anyWhite & valid);
+		}
+	}
+}
+
+void BitplaneStats::Build(const UBYTE * image, int widthByte, int width, int height) {
+	this->image = image;
+	this->widthByte = widthByte;
+	this->width = width;
+	this->height = height;
+	blocksX = (width + BlockSize - 1) / BlockSize;
+	blocksY = (height + BlockSize - 1) / BlockSize;
+	int stride = blocksX + 1;
+	table.assign(stride * (blocksY + 1), 0);
+	// Padding bits of the last byte are not pixels.
+	UBYTE lastMask = width % 8 ? (UBYTE)(0xFF << (8 - width % 8)) : 0xFF;
+	for(int by = 0; by < blocksY; ++by) {
+		int rows = std::min(BlockSize, height - by * BlockSize);
+		const UBYTE * block = image + by * BlockSize * widthByte;
+		uint32_t rowSum = 0;
+		for(int bx = 0; bx < blocksX; ++bx) {
+			UBYTE mask = bx == blocksX - 1 ? lastMask : 0xFF;
+			// The block's eight bytes, one per row, counted as a single word.
+			uint64_t word = 0;
+			for(int r = 0; r < rows; ++r) {
+				word |= (uint64_t)(UBYTE)(~block[r * widthByte + bx] & mask) << (8 * r);
+			}
+			rowSum += __builtin_popcountll(word);
+			table[(by + 1) * stride + bx + 1] = table[by * stride + bx + 1] + rowSum;
+		}
+	}
+}
+
+long BitplaneStats::Black(int x0, int y0, int x1, int y1) const {
+	bool aligned = x0 % BlockSize == 0 && y0 % BlockSize == 0 && (x1 % BlockSize == 0 || x1 == width) && (y1 % BlockSize == 0 || y1 == height);
+	if(aligned) {
+		return BlockBlack(x0 / BlockSize, y0 / BlockSize, (x1 + BlockSize - 1) / BlockSize, (y1 + BlockSize - 1) / BlockSize);
+	}
+	return CountBlack(image, widthByte, x0, y0, x1, y1);
+}
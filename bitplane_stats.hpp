@@ -0,0 +1,80 @@
+#ifndef _BITPLANE_STATS_HPP_
+#define _BITPLANE_STATS_HPP_
+
+#include "DEV_Config.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Black/white counts over rectangles of a 1bpp image in PackedFrame's layout
+ * (rows of widthByte bytes, most significant bit first, 1 = white).
+ *
+ * Rows are counted 64 pixels at a time with masked popcounts, which GCC lowers
+ * to cnt on aarch64. The Makefile sets no target flags, so on x86 they stay
+ * a libgcc call unless CFLAGS add -mpopcnt or a -march that has it, just as
+ * the AVX2 kernel needs -mavx2.
+ *
+ * Build() also sums BlockSize x BlockSize blocks into a summed-area table,
+ * after which any block-aligned rectangle costs four lookups.
+**/
+class BitplaneStats {
+	public: static constexpr int BlockSize = 8;
+	/**
+	 * Black pixels in [x0, x1) x [y0, y1), counted straight from the image.
+	**/
+	static long CountBlack(const UBYTE * image, int widthByte, int x0, int y0, int x1, int y1);
+	/**
+	 * Writes into edges (same layout and size as image) a plane whose black
+	 * pixels are those that differ in colour from their right or lower
+	 * neighbour, i.e. the boundary of the black set.
+	**/
+	static void MarkEdges(const UBYTE * image, int widthByte, int width, int height, UBYTE * edges);
+	/**
+	 * Writes into mixed (same layout and size as image) a plane whose black
+	 * pixels are those whose 3x3 neighbourhood holds both colours, eight
+	 * pixels per byte operation.
+	**/
+	static void MarkMixed(const UBYTE * image, int widthByte, int width, int height, UBYTE * mixed);
+	/**
+	 * Builds the summed-area table for a width x height image. The image must
+	 * stay unchanged while the table is in use.
+	**/
+	void Build(const UBYTE * image, int widthByte, int width, int height);
+	/**
+	 * Black pixels in [x0, x1) x [y0, y1): O(1) when all four edges are
+	 * multiples of BlockSize (or the image edge), a row scan otherwise.
+	**/
+	long Black(int x0, int y0, int x1, int y1) const;
+	/**
+	 * Black pixels in blocks [bx0, bx1) x [by0, by1).
+	**/
+	long BlockBlack(int bx0, int by0, int bx1, int by1) const {
+		int stride = blocksX + 1;
+		return (long) table[by1 * stride + bx1] - table[by0 * stride + bx1] - table[by1 * stride + bx0] + table[by0 * stride + bx0];
+	};
+	const UBYTE * Image() const {
+		return image;
+	};
+	int WidthByte() const {
+		return widthByte;
+	};
+	int Width() const {
+		return width;
+	};
+	int Height() const {
+		return height;
+	};
+	private: const UBYTE * image = nullptr;
+	int widthByte = 0;
+	int width = 0;
+	int height = 0;
+	int blocksX = 0;
+	int blocksY = 0;
+	/**
+	 * (blocksY + 1) x (blocksX + 1) prefix sums; entry (by, bx) holds the
+	 * black pixels above and left of block (by, bx).
+	**/
+	std::vector < uint32_t > table;
+};
+
+#endif
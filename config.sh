@@ -1,14 +1,14 @@
 #!/bin/bash
 
 file="./main.c"
-target_line=14
+pattern="^static constexpr unsigned long SecondsBetweenImages = .*;$"
 read -p "Enter the number of minutes to render the new image on the display: " minutes
 seconds=$((minutes * 60))
 new_line="static constexpr unsigned long SecondsBetweenImages = $seconds;"
 
 if [ -f "$file" ]; then
-    sed -i "${target_line}s|^.*$|$new_line|" "$file"
-    echo "Updated line $target_line in $file with the new update interval of $minutes minutes ($seconds seconds)."
+    sed -i "s|$pattern|$new_line|" "$file"
+    echo "Updated $file with the new update interval of $minutes minutes ($seconds seconds)."
 else
     echo "Error: File $file not found!"
     exit 1
@@ -0,0 +1,79 @@
+#ifndef _DOUBLE_DOUBLE_HPP_
+#define _DOUBLE_DOUBLE_HPP_
+
+#include "simd.hpp"
+
+/**
+ * Double-double arithmetic: a value is the unevaluated sum hi + lo of two
+ * doubles with |lo| <= ulp(hi) / 2, giving about 106 bits of mantissa.
+ * Built from the classic error-free transforms (Knuth's TwoSum, Dekker's
+ * split and product), which only need IEEE + - *. Everything is a template
+ * over T = double or VecD, so the same code runs one pixel or a vector of
+ * them. The transforms are only exact when a * b + c is not contracted into
+ * a fused multiply-add, hence -ffp-contract=off in the Makefile.
+**/
+template < typename T > static inline T Constant(double value);
+template < > inline double Constant < double > (double value) {
+	return value;
+}
+template < > inline VecD Constant < VecD > (double value) {
+	return VecD::Broadcast(value);
+}
+
+template < typename T >
+struct DoubleDouble {
+	T hi;
+	T lo;
+};
+
+template < typename T >
+static inline DoubleDouble < T > TwoSum(T a, T b) {
+	T s = a + b;
+	T bb = s - a;
+	return {s, (a - (s - bb)) + (b - bb)};
+}
+
+/**
+ * TwoSum for |a| >= |b|.
+**/
+template < typename T >
+static inline DoubleDouble < T > QuickTwoSum(T a, T b) {
+	T s = a + b;
+	return {s, b - (s - a)};
+}
+
+template < typename T >
+static inline DoubleDouble < T > TwoProduct(T a, T b) {
+	// 2^27 + 1 splits a double into two halves of 26 bits that multiply exactly.
+	const T splitter = Constant < T > (134217729.0);
+	T p = a * b;
+	T ta = splitter * a;
+	T a_hi = ta - (ta - a);
+	T a_lo = a - a_hi;
+	T tb = splitter * b;
+	T b_hi = tb - (tb - b);
+	T b_lo = b - b_hi;
+	return {p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+}
+
+template < typename T >
+static inline DoubleDouble < T > operator + (DoubleDouble < T > a, DoubleDouble < T > b) {
+	DoubleDouble < T > s = TwoSum(a.hi, b.hi);
+	DoubleDouble < T > t = TwoSum(a.lo, b.lo);
+	s = QuickTwoSum(s.hi, s.lo + t.hi);
+	return QuickTwoSum(s.hi, s.lo + t.lo);
+}
+
+template < typename T >
+static inline DoubleDouble < T > operator - (DoubleDouble < T > a, DoubleDouble < T > b) {
+	const T zero = Constant < T > (0.0);
+	return a + DoubleDouble < T > {zero - b.hi, zero - b.lo};
+}
+
+template < typename T >
+static inline DoubleDouble < T > operator * (DoubleDouble < T > a, DoubleDouble < T > b) {
+	DoubleDouble < T > p = TwoProduct(a.hi, b.hi);
+	return QuickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "error_diffusion.hpp"
+#include "simd.hpp"
+#include <cstring>
+
+// Tone levels carry 4 fractional bits.
+static constexpr int FractionBits = 4;
+static constexpr int32_t White = 255 << FractionBits;
+static constexpr int32_t Threshold = 128 << FractionBits;
+
+static const char * const ModeNames[] = {"none", "fs", "atkinson", "sierra", "bayer", "bluenoise"};
+
+const char * DitherModeName(DitherMode mode) {
+	return ModeNames[mode];
+}
+
+bool ParseDitherMode(const char * name, DitherMode & mode) {
+	for(int k = 0; k < (int) (sizeof(ModeNames) / sizeof(ModeNames[0])); ++k) {
+		if(strcmp(name, ModeNames[k]) == 0) {
+			mode = (DitherMode) k;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ErrorDiffusion::Reset(int width, DitherMode mode) {
+	this->width = width;
+	this->mode = mode;
+	// Spread() reads and writes whole vectors, one lane past the last pixel.
+	stride = (width + VecI::Lanes) / VecI::Lanes * VecI::Lanes;
+	errors.assign(stride + 2, 0);
+	rows.assign(3 * stride, 0);
+	current = rows.data();
+	next = current + stride;
+	after = next + stride;
+}
+
+template < DitherMode Mode > void ErrorDiffusion::Scan(const UBYTE * tone, UBYTE * black) {
+	int32_t carry = 0;
+	int32_t carry2 = 0;
+	int32_t * error = errors.data() + 1;
+	for(int x = 0; x < width; ++x) {
+		int32_t value = (tone[x] << FractionBits) + current[x] + carry;
+		black[x] = value < Threshold;
+		int32_t e = black[x] ? value : value - White;
+		error[x] = e;
+		if(Mode == DitherFloydSteinberg) {
+			carry = (7 * e + 8) >> 4;
+		} else if(Mode == DitherSierraLite) {
+			carry = (e + 1) >> 1;
+		} else {
+			int32_t eighth = (e + 4) >> 3;
+			carry = carry2 + eighth;
+			carry2 = eighth;
+		}
+	}
+}
+
+template < DitherMode Mode > void ErrorDiffusion::Spread() {
+	// Pixel x receives from x - 1, x and x + 1 of the row above: error[x],
+	// error[x + 1] and error[x + 2] in the padded array.
+	const int32_t * error = errors.data();
+	for(int x = 0; x < stride; x += VecI::Lanes) {
+		VecI left = VecI::Load(error + x);
+		VecI middle = VecI::Load(error + x + 1);
+		VecI right = VecI::Load(error + x + 2);
+		if(Mode == DitherFloydSteinberg) {
+			// 1/16 from the left, 5/16 from above, 3/16 from the right.
+			VecI sum = left + ShiftLeft < 2 > (middle) + middle + ShiftLeft < 1 > (right) + right;
+			(VecI::Load(next + x) + ShiftRight < 4 > (sum + VecI::Broadcast(8))).Store(next + x);
+		} else if(Mode == DitherSierraLite) {
+			VecI sum = middle + right;
+			(VecI::Load(next + x) + ShiftRight < 2 > (sum + VecI::Broadcast(2))).Store(next + x);
+		} else {
+			VecI sum = left + middle + right;
+			(VecI::Load(next + x) + ShiftRight < 3 > (sum + VecI::Broadcast(4))).Store(next + x);
+			(VecI::Load(after + x) + ShiftRight < 3 > (middle + VecI::Broadcast(4))).Store(after + x);
+		}
+	}
+}
+
+void ErrorDiffusion::Row(const UBYTE * tone, UBYTE * black) {
+	switch(mode) {
+		case DitherNone:
+		case DitherBayer:
+		case DitherBlueNoise:
+			for(int x = 0; x < width; ++x) {
+				black[x] = tone[x] < 128;
+			}
+			return;
+		case DitherFloydSteinberg:
+			Scan < DitherFloydSteinberg > (tone, black);
+			Spread < DitherFloydSteinberg > ();
+			break;
+		case DitherAtkinson:
+			Scan < DitherAtkinson > (tone, black);
+			Spread < DitherAtkinson > ();
+			break;
+		case DitherSierraLite:
+			Scan < DitherSierraLite > (tone, black);
+			Spread < DitherSierraLite > ();
+			break;
+	}
+	memset(current, 0, stride * sizeof(int32_t));
+	int32_t * consumed = current;
+	current = next;
+	next = after;
+	after = consumed;
+}
@@ -0,0 +1,77 @@
+#ifndef _ERROR_DIFFUSION_HPP_
+#define _ERROR_DIFFUSION_HPP_
+
+#include "DEV_Config.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * How the 1bpp frame is drawn from the continuous escape field:
+ *   DitherNone            black inside the set, white outside
+ *   DitherFloydSteinberg  7/16 of the error to the right, 3/16, 5/16 and
+ *                         1/16 to the row below
+ *   DitherAtkinson        1/8 to each of six neighbours over two rows; the
+ *                         other 2/8 is dropped, which keeps flat areas clean
+ *   DitherSierraLite      2/4 to the right, 1/4 and 1/4 to the row below
+ *   DitherBayer           ordered, against an 8x8 Bayer matrix
+ *   DitherBlueNoise       ordered, against a 64x64 blue-noise mask
+ * Floyd-Steinberg and Sierra-Lite are the two kernels of the 3.7" panel's
+ * dithering engine (EPD_3IN7_1Gray_Display_Dithered), done here in software
+ * for panels without one. The ordered modes (see OrderedDither) need no pass
+ * in row order.
+**/
+enum DitherMode {
+	DitherNone,
+	DitherFloydSteinberg,
+	DitherAtkinson,
+	DitherSierraLite,
+	DitherBayer,
+	DitherBlueNoise,
+};
+
+static inline bool IsOrderedDither(DitherMode mode) {
+	return mode == DitherBayer || mode == DitherBlueNoise;
+}
+
+/**
+ * Command-line names of the modes: none, fs, atkinson, sierra, bayer,
+ * bluenoise.
+**/
+const char * DitherModeName(DitherMode mode);
+bool ParseDitherMode(const char * name, DitherMode & mode);
+
+/**
+ * Error diffusion over a frame fed one row at a time, top to bottom, for
+ * the first four modes; the ordered ones are thresholded as plain. The
+ * error owed to the rows below is kept in Q4 fixed point (1/16 of a tone
+ * level) in int32 rows.
+ *
+ * Only the carry to the right depends on the pixel just decided, so a row is
+ * a scalar scan that thresholds and records each pixel's error, followed by
+ * a VecI pass that spreads the whole row of errors onto the rows below.
+**/
+class ErrorDiffusion {
+	public: void Reset(int width, DitherMode mode);
+	/**
+	 * Dithers the next row: tone[x] runs from 0 (black) to 255 (white), and
+	 * black[x] is set to 1 for the pixels drawn black.
+	**/
+	void Row(const UBYTE * tone, UBYTE * black);
+	DitherMode Mode() const {
+		return mode;
+	};
+	private: template < DitherMode Mode > void Scan(const UBYTE * tone, UBYTE * black);
+	template < DitherMode Mode > void Spread();
+	DitherMode mode = DitherNone;
+	int width = 0;
+	int stride = 0;
+	// Errors of the row just scanned, pixel x at x + 1, zero padded both sides.
+	std::vector < int32_t > errors;
+	// Error owed to this row and the two below it, stride entries each.
+	std::vector < int32_t > rows;
+	int32_t * current = nullptr;
+	int32_t * next = nullptr;
+	int32_t * after = nullptr;
+};
+
+#endif
@@ -0,0 +1,497 @@
+#include "escape_kernel.hpp"
+#include "simd.hpp"
+#include "double_double.hpp"
+#include <cmath>
+
+/**
+ * Points are processed in groups of Unroll vectors, so that a group holds
+ * 2 (scalar), 4 (SSE2/NEON) or 8 (AVX2) pixels. Interleaving independent
+ * vectors hides the multiply latency, and a lane that escapes is simply
+ * masked off: its counter stops while the rest of the group keeps iterating,
+ * and the group exits as soon as no lane is active.
+ *
+ * With DetectPeriod, each lane also keeps a saved orbit point that is
+ * refreshed at every power-of-two iteration (Brent's scheme). A lane whose
+ * orbit returns to within the tolerance of the saved point has settled on
+ * a cycle; it is marked bounded and masked off like an escaped lane.
+**/
+static constexpr int Unroll = 2;
+static constexpr int GroupSize = Unroll * VecD::Lanes;
+// Iterations an escaped orbit is carried on for the distance estimate: from
+// |z| just over 2, enough to take it past 2^16.
+static constexpr int DistanceIterations = 4;
+
+/**
+ * Arrays of one batch of points, all indexed alike. startX/startY continue
+ * orbits left by an earlier call (null: start at z = c); endX/endY/proven
+ * receive where each orbit stopped and escapeR2 |z|^2 at the escape
+ * (null: not wanted).
+**/
+struct PointBatch {
+	const double * cx;
+	const double * cy;
+	const double * startX;
+	const double * startY;
+	int * escapeIter;
+	double * endX;
+	double * endY;
+	bool * proven;
+	double * escapeR2;
+	PointBatch At(int k) const {
+		return {cx + k, cy + k, startX ? startX + k : nullptr, startY ? startY + k : nullptr, escapeIter + k, endX ? endX + k : nullptr, endY ? endY + k : nullptr, proven ? proven + k : nullptr, escapeR2 ? escapeR2 + k : nullptr};
+	};
+};
+
+/**
+ * Carries an escaped orbit DistanceIterations further, then tells whether the
+ * estimate puts its point within threshold of the set.
+**/
+template < class F >
+static bool EstimateWithin(double cx, double cy, double zx, double zy, double dzx, double dzy, double threshold) {
+	for(int i = 0; i < DistanceIterations; ++i) {
+		F::Derivative(zx, zy, dzx, dzy);
+		F::Step(zx, zy, cx, cy);
+	}
+	double r2 = zx * zx + zy * zy;
+	// Written so that a NaN from an overflowed derivative compares as within.
+	return !(std::sqrt(r2) * std::log(r2) >= threshold * std::hypot(dzx, dzy));
+}
+
+/**
+ * Iterates formula F. With KeepRadius, each lane also latches |z|^2 at the
+ * iteration it escapes, one select per iteration, for the normalized
+ * iteration count. With Distance, each lane iterates dz alongside z and
+ * latches both at the escape; the lanes that escaped near the set are
+ * turned bounded once the group is done.
+**/
+template < class F, bool DetectPeriod, bool KeepRadius, bool Distance >
+static bool RunGroup(const PointBatch & batch, int start, const KernelOptions & options) {
+	const int iterations = options.iterations;
+	const VecD four = VecD::Broadcast(4.0);
+	const VecD one = VecD::Broadcast(1.0);
+	const VecD tolerance2 = VecD::Broadcast(options.periodTolerance * options.periodTolerance);
+	VecD c_x[Unroll], c_y[Unroll], z_x[Unroll], z_y[Unroll], n[Unroll];
+	VecD saved_x[Unroll], saved_y[Unroll], radius2[Unroll];
+	VecD dz_x[Unroll], dz_y[Unroll], escape_x[Unroll], escape_y[Unroll], escape_dx[Unroll], escape_dy[Unroll];
+	MaskD active[Unroll], periodic[Unroll];
+	for(int u = 0; u < Unroll; ++u) {
+		// Either way the orbit starts at the pixel.
+		c_x[u] = F::IsJulia ? VecD::Broadcast(options.juliaX) : VecD::Load(batch.cx + u * VecD::Lanes);
+		c_y[u] = F::IsJulia ? VecD::Broadcast(options.juliaY) : VecD::Load(batch.cy + u * VecD::Lanes);
+		z_x[u] = VecD::Load((batch.startX ? batch.startX : batch.cx) + u * VecD::Lanes);
+		z_y[u] = VecD::Load((batch.startY ? batch.startY : batch.cy) + u * VecD::Lanes);
+		n[u] = VecD::Broadcast(start);
+		active[u] = MaskD::All();
+		periodic[u] = MaskD::None();
+		saved_x[u] = z_x[u];
+		saved_y[u] = z_y[u];
+		radius2[u] = four;
+		// z starts at the pixel, whose derivative is 1.
+		dz_x[u] = one;
+		dz_y[u] = VecD::Broadcast(0.0);
+		escape_x[u] = escape_y[u] = escape_dx[u] = escape_dy[u] = dz_y[u];
+	}
+	int checkpoint = 2;
+	for(int i = start; i < iterations; ++i) {
+		bool anyActive = false;
+		for(int u = 0; u < Unroll; ++u) {
+			if(Distance) {
+				F::Derivative(z_x[u], z_y[u], dz_x[u], dz_y[u]);
+			}
+			F::Step(z_x[u], z_y[u], c_x[u], c_y[u]);
+			VecD r2 = z_x[u] * z_x[u] + z_y[u] * z_y[u];
+			MaskD escaped = r2 > four;
+			if(KeepRadius) {
+				radius2[u] = Select(active[u] & escaped, r2, radius2[u]);
+			}
+			if(Distance) {
+				MaskD escaping = active[u] & escaped;
+				escape_x[u] = Select(escaping, z_x[u], escape_x[u]);
+				escape_y[u] = Select(escaping, z_y[u], escape_y[u]);
+				escape_dx[u] = Select(escaping, dz_x[u], escape_dx[u]);
+				escape_dy[u] = Select(escaping, dz_y[u], escape_dy[u]);
+			}
+			active[u] = AndNot(active[u], escaped);
+			n[u] = MaskedAdd(n[u], active[u], one);
+			if(DetectPeriod) {
+				VecD d_x = z_x[u] - saved_x[u];
+				VecD d_y = z_y[u] - saved_y[u];
+				MaskD cycled = active[u] & (d_x * d_x + d_y * d_y < tolerance2);
+				periodic[u] = periodic[u] | cycled;
+				active[u] = AndNot(active[u], cycled);
+			}
+			anyActive |= Any(active[u]);
+		}
+		if(!anyActive) {
+			break;
+		}
+		if(DetectPeriod && i - start + 1 == checkpoint) {
+			for(int u = 0; u < Unroll; ++u) {
+				saved_x[u] = z_x[u];
+				saved_y[u] = z_y[u];
+			}
+			checkpoint *= 2;
+		}
+	}
+	double counts[GroupSize];
+	const VecD bounded = VecD::Broadcast(iterations);
+	bool anyPeriodic = false;
+	for(int u = 0; u < Unroll; ++u) {
+		if(DetectPeriod) {
+			n[u] = Select(periodic[u], bounded, n[u]);
+			anyPeriodic |= Any(periodic[u]);
+		}
+		n[u].Store(counts + u * VecD::Lanes);
+		if(KeepRadius) {
+			radius2[u].Store(batch.escapeR2 + u * VecD::Lanes);
+		}
+		if(batch.endX) {
+			z_x[u].Store(batch.endX + u * VecD::Lanes);
+			z_y[u].Store(batch.endY + u * VecD::Lanes);
+		}
+		if(batch.proven) {
+			int bits = DetectPeriod ? Bits(periodic[u]) : 0;
+			for(int k = 0; k < VecD::Lanes; ++k) {
+				batch.proven[u * VecD::Lanes + k] = bits >> k & 1;
+			}
+		}
+	}
+	if(Distance) {
+		double ex[GroupSize], ey[GroupSize], edx[GroupSize], edy[GroupSize];
+		for(int u = 0; u < Unroll; ++u) {
+			escape_x[u].Store(ex + u * VecD::Lanes);
+			escape_y[u].Store(ey + u * VecD::Lanes);
+			escape_dx[u].Store(edx + u * VecD::Lanes);
+			escape_dy[u].Store(edy + u * VecD::Lanes);
+		}
+		for(int k = 0; k < GroupSize; ++k) {
+			double cx = F::IsJulia ? options.juliaX : batch.cx[k];
+			double cy = F::IsJulia ? options.juliaY : batch.cy[k];
+			if(counts[k] < iterations && EstimateWithin < F > (cx, cy, ex[k], ey[k], edx[k], edy[k], options.distanceThreshold)) {
+				counts[k] = iterations;
+				if(KeepRadius) {
+					batch.escapeR2[k] = 4.0;
+				}
+				if(batch.endX) {
+					batch.endX[k] = ex[k];
+					batch.endY[k] = ey[k];
+				}
+			}
+		}
+	}
+	for(int k = 0; k < GroupSize; ++k) {
+		batch.escapeIter[k] = (int) counts[k];
+	}
+	return anyPeriodic;
+}
+
+typedef bool (* GroupKernel)(const PointBatch & batch, int start, const KernelOptions & options);
+
+/**
+ * The RunGroup instance for one combination of outputs, picked once per call
+ * so that the iteration loop itself never tests them.
+**/
+template < class F, bool DetectPeriod >
+static GroupKernel SelectGroup(bool keepRadius, bool distance) {
+	static const GroupKernel kernels[] = {
+		RunGroup < F, DetectPeriod, false, false >,
+		RunGroup < F, DetectPeriod, false, true >,
+		RunGroup < F, DetectPeriod, true, false >,
+		RunGroup < F, DetectPeriod, true, true >,
+	};
+	return kernels[keepRadius * 2 + (distance && F::Holomorphic)];
+}
+
+bool EscapeKernel::WithinDistance(double cx, double cy, double zx, double zy, double dzx, double dzy, double threshold) {
+	return EstimateWithin < MandelbrotFormula > (cx, cy, zx, zy, dzx, dzy, threshold);
+}
+
+/**
+ * Inscribed disks {centre x, |centre y|, radius^2} of the largest bulbs after
+ * the cardioid and the period-2 disk: the 1/3 and 1/4 bulbs of the cardioid
+ * and the 1/2 and 1/3 bulbs of the period-2 disk. Centres are the component
+ * nuclei; radii are the distance to the nearest boundary point (found from
+ * the multiplier map) shrunk by 3% so the disks stay strictly inside.
+**/
+static const double HigherBulbs[][3] = {
+	{-0.12256116687665365, 0.7448617666197442, 0.0893774 * 0.0893774},  // period 3
+	{0.2822713907669139, 0.5300606175785253, 0.0412126 * 0.0412126},    // period 4
+	{-1.310702641336833, 0.0, 0.0556744 * 0.0556744},                   // period 4
+	{-1.1380006666509646, 0.24033240126209807, 0.0248956 * 0.0248956},  // period 6
+};
+
+EscapeKernel::InteriorTest EscapeKernel::Interior(double cx, double cy, unsigned tests) {
+	double y2 = cy * cy;
+	if(tests & InteriorCardioid) {
+		double xq = cx - 0.25;
+		double q = xq * xq + y2;
+		if(q * (q + xq) < 0.25 * y2) {
+			return InteriorCardioid;
+		}
+	}
+	if(tests & InteriorPeriod2) {
+		double xp = cx + 1.0;
+		if(xp * xp + y2 < 0.0625) {
+			return InteriorPeriod2;
+		}
+	}
+	if(tests & InteriorHigherBulbs) {
+		double ay = cy < 0.0 ? -cy : cy;
+		for(const auto & bulb: HigherBulbs) {
+			double dx = cx - bulb[0];
+			double dy = ay - bulb[1];
+			if(dx * dx + dy * dy < bulb[2]) {
+				return InteriorHigherBulbs;
+			}
+		}
+	}
+	return InteriorNone;
+}
+
+/**
+ * The periodicity check nearly doubles the cost of an iteration, which only
+ * pays off for orbits that settle quickly. As in Fractint, it is switched on
+ * for a group only when the previous group had a bounded point; a checked
+ * group that found no cycle (slowly converging orbits near the boundary)
+ * backs the check off for 1, 2, 4 ... 16 groups before it is tried again.
+**/
+static void RunPoints(const PointBatch & batch, int count, int start, const KernelOptions & options, bool distance) {
+	const int iterations = options.iterations;
+	bool previousBounded = false;
+	int skipGroups = 0;
+	int backoff = 1;
+	const bool keepRadius = batch.escapeR2 != nullptr;
+	distance = distance && options.distanceThreshold > 0.0;
+	GroupKernel checked = nullptr, unchecked = nullptr;
+	DispatchFormula(options.formula, [ & ](auto formula) {
+		typedef decltype(formula) F;
+		checked = SelectGroup < F, true > (keepRadius, distance);
+		unchecked = SelectGroup < F, false > (keepRadius, distance);
+	});
+	auto runGroup = [ & ](const PointBatch & group) {
+		if(options.periodTolerance > 0.0 && previousBounded && skipGroups == 0) {
+			bool cycled = checked(group, start, options);
+			if(cycled) {
+				backoff = 1;
+			} else {
+				skipGroups = backoff;
+				backoff = backoff < 16 ? backoff * 2 : 16;
+			}
+		} else {
+			unchecked(group, start, options);
+			if(skipGroups > 0) {
+				skipGroups--;
+			}
+		}
+		previousBounded = false;
+		for(int g = 0; g < GroupSize; ++g) {
+			previousBounded |= group.escapeIter[g] >= iterations;
+		}
+	};
+	int k = 0;
+	for(; k + GroupSize <= count; k += GroupSize) {
+		runGroup(batch.At(k));
+	}
+	if(k < count) {
+		// Pad the tail group by repeating the last point.
+		double tailX[GroupSize], tailY[GroupSize], tailStartX[GroupSize], tailStartY[GroupSize], tailEndX[GroupSize], tailEndY[GroupSize], tailR2[GroupSize];
+		int tailIter[GroupSize];
+		bool tailProven[GroupSize];
+		for(int t = 0; t < GroupSize; ++t) {
+			int src = (k + t < count) ? k + t : count - 1;
+			tailX[t] = batch.cx[src];
+			tailY[t] = batch.cy[src];
+			tailStartX[t] = batch.startX ? batch.startX[src] : 0.0;
+			tailStartY[t] = batch.startY ? batch.startY[src] : 0.0;
+		}
+		PointBatch tail = {tailX, tailY, batch.startX ? tailStartX : nullptr, batch.startY ? tailStartY : nullptr, tailIter, tailEndX, tailEndY, tailProven, keepRadius ? tailR2 : nullptr};
+		runGroup(tail);
+		for(int t = 0; k + t < count; ++t) {
+			batch.escapeIter[k + t] = tailIter[t];
+			if(batch.endX) {
+				batch.endX[k + t] = tailEndX[t];
+				batch.endY[k + t] = tailEndY[t];
+			}
+			if(batch.proven) {
+				batch.proven[k + t] = tailProven[t];
+			}
+			if(keepRadius) {
+				batch.escapeR2[k + t] = tailR2[t];
+			}
+		}
+	}
+}
+
+/**
+ * With Distance, as RunGroup; the derivative only needs plain doubles, so it
+ * follows the high parts of z.
+**/
+template < bool Distance >
+static void RunDoubleDoubleGroup(const double * cxHi, const double * cxLo, const double * cyHi, const double * cyLo, int iterations, int * escapeIter, double * escapeR2, double distanceThreshold) {
+	typedef DoubleDouble < VecD > Value;
+	const VecD four = VecD::Broadcast(4.0);
+	const VecD one = VecD::Broadcast(1.0);
+	const VecD two = VecD::Broadcast(2.0);
+	Value c_x = {VecD::Load(cxHi), VecD::Load(cxLo)};
+	Value c_y = {VecD::Load(cyHi), VecD::Load(cyLo)};
+	Value z_x = c_x;
+	Value z_y = c_y;
+	VecD n = VecD::Broadcast(0.0);
+	VecD radius2 = four;
+	VecD dz_x = one;
+	VecD dz_y = VecD::Broadcast(0.0);
+	VecD escape_x = dz_y, escape_y = dz_y, escape_dx = dz_y, escape_dy = dz_y;
+	MaskD active = MaskD::All();
+	for(int i = 0; i < iterations; ++i) {
+		if(Distance) {
+			VecD dz_x_old = dz_x;
+			dz_x = two * (z_x.hi * dz_x - z_y.hi * dz_y) + one;
+			dz_y = two * (z_x.hi * dz_y + z_y.hi * dz_x_old);
+		}
+		Value xx = z_x * z_x;
+		Value yy = z_y * z_y;
+		Value xy = z_x * z_y;
+		z_x = xx - yy + c_x;
+		z_y = Value {two * xy.hi, two * xy.lo} + c_y;
+		// The high parts alone decide |z| > 2; the low parts are below its ulp.
+		VecD r2 = z_x.hi * z_x.hi + z_y.hi * z_y.hi;
+		MaskD escaped = r2 > four;
+		if(escapeR2) {
+			radius2 = Select(active & escaped, r2, radius2);
+		}
+		if(Distance) {
+			MaskD escaping = active & escaped;
+			escape_x = Select(escaping, z_x.hi, escape_x);
+			escape_y = Select(escaping, z_y.hi, escape_y);
+			escape_dx = Select(escaping, dz_x, escape_dx);
+			escape_dy = Select(escaping, dz_y, escape_dy);
+		}
+		active = AndNot(active, escaped);
+		n = MaskedAdd(n, active, one);
+		if(!Any(active)) {
+			break;
+		}
+	}
+	double counts[VecD::Lanes];
+	n.Store(counts);
+	if(escapeR2) {
+		radius2.Store(escapeR2);
+	}
+	if(Distance) {
+		double ex[VecD::Lanes], ey[VecD::Lanes], edx[VecD::Lanes], edy[VecD::Lanes];
+		escape_x.Store(ex);
+		escape_y.Store(ey);
+		escape_dx.Store(edx);
+		escape_dy.Store(edy);
+		for(int k = 0; k < VecD::Lanes; ++k) {
+			if(counts[k] < iterations && EscapeKernel::WithinDistance(cxHi[k], cyHi[k], ex[k], ey[k], edx[k], edy[k], distanceThreshold)) {
+				counts[k] = iterations;
+				if(escapeR2) {
+					escapeR2[k] = 4.0;
+				}
+			}
+		}
+	}
+	for(int k = 0; k < VecD::Lanes; ++k) {
+		escapeIter[k] = (int) counts[k];
+	}
+}
+
+void EscapeKernel::RunDoubleDouble(const double * cxHi, const double * cxLo, const double * cyHi, const double * cyLo, int count, const KernelOptions & options, int * escapeIter, double * escapeR2) {
+	const int lanes = VecD::Lanes;
+	auto runGroup = options.distanceThreshold > 0.0 ? RunDoubleDoubleGroup < true > : RunDoubleDoubleGroup < false >;
+	int k = 0;
+	for(; k + lanes <= count; k += lanes) {
+		runGroup(cxHi + k, cxLo + k, cyHi + k, cyLo + k, options.iterations, escapeIter + k, escapeR2 ? escapeR2 + k : nullptr, options.distanceThreshold);
+	}
+	if(k < count) {
+		double tail[4][VecD::Lanes], tailR2[VecD::Lanes];
+		int tailIter[VecD::Lanes];
+		for(int t = 0; t < lanes; ++t) {
+			int src = (k + t < count) ? k + t : count - 1;
+			tail[0][t] = cxHi[src];
+			tail[1][t] = cxLo[src];
+			tail[2][t] = cyHi[src];
+			tail[3][t] = cyLo[src];
+		}
+		runGroup(tail[0], tail[1], tail[2], tail[3], options.iterations, tailIter, escapeR2 ? tailR2 : nullptr, options.distanceThreshold);
+		for(int t = 0; k + t < count; ++t) {
+			escapeIter[k + t] = tailIter[t];
+			if(escapeR2) {
+				escapeR2[k + t] = tailR2[t];
+			}
+		}
+	}
+}
+
+void EscapeKernel::Run(const double * cx, const double * cy, int count, const KernelOptions & options, int * escapeIter, KernelStats * stats, const OrbitState * state, double * escapeR2) {
+	PointBatch batch = {cx, cy, nullptr, nullptr, escapeIter, state ? state->zx : nullptr, state ? state->zy : nullptr, state ? state->proven : nullptr, escapeR2};
+	// The interior tests know the bulbs of the Mandelbrot set only.
+	if(options.interiorTests == InteriorNone || options.formula != FormulaMandelbrot) {
+		RunPoints(batch, count, 0, options, true);
+		return;
+	}
+	// Points proven interior are filled in directly; the rest are packed
+	// together so the vector groups only ever iterate undecided points.
+	const int blockSize = 64;
+	double packedX[blockSize], packedY[blockSize], packedEndX[blockSize], packedEndY[blockSize], packedR2[blockSize];
+	int packedIter[blockSize], packedIndex[blockSize];
+	bool packedProven[blockSize];
+	PointBatch packedBatch = {packedX, packedY, nullptr, nullptr, packedIter, packedEndX, packedEndY, packedProven, escapeR2 ? packedR2 : nullptr};
+	KernelStats skipped;
+	for(int start = 0; start < count; start += blockSize) {
+		int end = start + blockSize < count ? start + blockSize : count;
+		int packed = 0;
+		for(int k = start; k < end; ++k) {
+			InteriorTest test = Interior(cx[k], cy[k], options.interiorTests);
+			if(test == InteriorNone) {
+				packedX[packed] = cx[k];
+				packedY[packed] = cy[k];
+				packedIndex[packed++] = k;
+				continue;
+			}
+			escapeIter[k] = options.iterations;
+			if(escapeR2) {
+				escapeR2[k] = 4.0;
+			}
+			if(state) {
+				state->zx[k] = cx[k];
+				state->zy[k] = cy[k];
+				state->proven[k] = true;
+			}
+			if(test == InteriorCardioid) {
+				skipped.cardioidSkipped++;
+			} else if(test == InteriorPeriod2) {
+				skipped.period2Skipped++;
+			} else {
+				skipped.higherBulbSkipped++;
+			}
+		}
+		if(packed > 0) {
+			RunPoints(packedBatch, packed, 0, options, true);
+			for(int p = 0; p < packed; ++p) {
+				escapeIter[packedIndex[p]] = packedIter[p];
+				if(escapeR2) {
+					escapeR2[packedIndex[p]] = packedR2[p];
+				}
+				if(state) {
+					state->zx[packedIndex[p]] = packedEndX[p];
+					state->zy[packedIndex[p]] = packedEndY[p];
+					state->proven[packedIndex[p]] = packedProven[p];
+				}
+			}
+		}
+	}
+	if(stats) {
+		stats->Add(skipped);
+	}
+}
+
+void EscapeKernel::Continue(const double * cx, const double * cy, int count, int done, const KernelOptions & options, int * escapeIter, const OrbitState & state, double * escapeR2) {
+	PointBatch batch = {cx, cy, state.zx, state.zy, escapeIter, state.zx, state.zy, state.proven, escapeR2};
+	RunPoints(batch, count, done, options, false);
+}
+
+const char * EscapeKernel::Backend() {
+	return SIMD_BACKEND;
+}
@@ -0,0 +1,118 @@
+#ifndef _ESCAPE_KERNEL_HPP_
+#define _ESCAPE_KERNEL_HPP_
+
+#include "fractal_formula.hpp"
+
+namespace EscapeKernel {
+	/**
+	 * Closed-form interior tests run before a point is iterated. A point that
+	 * lies in one of the enabled shapes is known to be bounded and is reported
+	 * as inside without iterating.
+	**/
+	enum InteriorTest {
+		InteriorNone = 0x00,
+		InteriorCardioid = 0x01,   // main cardioid
+		InteriorPeriod2 = 0x02,    // period-2 disk |c + 1| < 1/4
+		InteriorHigherBulbs = 0x04, // inscribed disks of the period-3, 4 and 6 bulbs
+		InteriorDefault = InteriorCardioid | InteriorPeriod2,
+	};
+}
+
+struct KernelOptions {
+	int iterations;
+	FractalFormula formula = FormulaMandelbrot;
+	// c of FormulaJulia.
+	double juliaX = 0.0;
+	double juliaY = 0.0;
+	unsigned interiorTests = EscapeKernel::InteriorDefault;
+	/**
+	 * Orbit distance below which a point is taken to have settled on a cycle
+	 * (Brent periodicity check); 0 disables the check.
+	**/
+	double periodTolerance = 0.0;
+	/**
+	 * Distance from the set below which an escaping point is drawn as bounded
+	 * anyway, by the exterior distance estimate; 0 disables the estimate.
+	 * About half a pixel keeps filaments that no sample point lands on.
+	**/
+	double distanceThreshold = 0.0;
+};
+
+/**
+ * Pixels skipped by each interior test, summed per thread and merged per frame.
+**/
+struct KernelStats {
+	unsigned long long cardioidSkipped = 0;
+	unsigned long long period2Skipped = 0;
+	unsigned long long higherBulbSkipped = 0;
+	void Add(const KernelStats & other) {
+		cardioidSkipped += other.cardioidSkipped;
+		period2Skipped += other.period2Skipped;
+		higherBulbSkipped += other.higherBulbSkipped;
+	}
+};
+
+/**
+ * Where each point's orbit stopped, so that a later call can carry on from
+ * there: z after the last iteration run, and whether the point was proven
+ * bounded (interior test or detected cycle) rather than merely not escaped
+ * yet. z is only meaningful for points that did not escape; a point made
+ * bounded by the distance estimate keeps the z it escaped with, so that
+ * |z| > 2 tells it apart.
+**/
+struct OrbitState {
+	double * zx;
+	double * zy;
+	bool * proven;
+};
+
+namespace EscapeKernel {
+	/**
+	 * Iterates z = z^2 + c, starting from z = c, for `count` points at once and
+	 * stores in escapeIter[k] the iteration at which |z| first exceeded 2, or
+	 * options.iterations when the point stayed bounded (i.e. is drawn black).
+	 * Results are bit-identical on every backend. Skipped points are counted
+	 * into stats when it is not null, and the orbits are left in state when
+	 * that is not null. escapeR2, when not null, gets |z|^2 at the escape
+	 * (4 for bounded points), from which the normalized iteration count
+	 * follows. With options.distanceThreshold, each orbit also carries its
+	 * derivative dz/dc, and a point that escapes within that distance of the
+	 * set is reported as bounded. Other formulas than the Mandelbrot set
+	 * get neither the interior tests nor, when not holomorphic, the distance
+	 * estimate; for a Julia set (cx, cy) is the start z.
+	**/
+	void Run(const double * cx, const double * cy, int count, const KernelOptions & options, int * escapeIter, KernelStats * stats = nullptr, const OrbitState * state = nullptr, double * escapeR2 = nullptr);
+	/**
+	 * Continues orbits that Run left in state after `done` iterations up to
+	 * options.iterations, updating state in place. escapeIter gets the same
+	 * totals a single Run with options.iterations would give, less the
+	 * distance estimate: the derivative is not part of the state.
+	**/
+	void Continue(const double * cx, const double * cy, int count, int done, const KernelOptions & options, int * escapeIter, const OrbitState & state, double * escapeR2 = nullptr);
+	/**
+	 * Same as Run with each coordinate given as the double-double hi + lo,
+	 * for views whose pixels are too close together for plain doubles.
+	 * Interior tests and the periodicity check are not applied: at those
+	 * depths a frame never reaches the large bulbs, and the period tolerance
+	 * would be below the resolution of the escape test. Mandelbrot set only.
+	**/
+	void RunDoubleDouble(const double * cxHi, const double * cxLo, const double * cyHi, const double * cyLo, int count, const KernelOptions & options, int * escapeIter, double * escapeR2 = nullptr);
+	/**
+	 * Whether c lies within threshold of the set, given the z and dz/dc its
+	 * orbit escaped with. The estimate 2 |z| ln |z| / |dz| is at most four
+	 * times the true distance and at least the distance itself, and sharper
+	 * the larger |z| is, so the orbit is first carried a few iterations past
+	 * the escape. An estimate lost to overflow counts as within.
+	**/
+	bool WithinDistance(double cx, double cy, double zx, double zy, double dzx, double dzy, double threshold);
+	/**
+	 * Returns the InteriorTest that proves (cx, cy) bounded, or InteriorNone.
+	**/
+	InteriorTest Interior(double cx, double cy, unsigned tests);
+	/**
+	 * Name of the vector backend compiled in ("avx2", "sse2", "neon" or "scalar").
+	**/
+	const char * Backend();
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include "fractal_formula.hpp"
+#include <cstring>
+
+static const char * const FormulaNames[] = {"mandelbrot", "multibrot3", "multibrot4", "tricorn", "burningship", "julia"};
+
+const char * FormulaName(FractalFormula formula) {
+	return FormulaNames[formula];
+}
+
+bool ParseFormula(const char * name, FractalFormula & formula) {
+	for(int k = 0; k < (int) (sizeof(FormulaNames) / sizeof(FormulaNames[0])); ++k) {
+		if(strcmp(name, FormulaNames[k]) == 0) {
+			formula = (FractalFormula) k;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,138 @@
+#ifndef _FRACTAL_FORMULA_HPP_
+#define _FRACTAL_FORMULA_HPP_
+
+#include "simd.hpp"
+#include "double_double.hpp"
+
+/**
+ * Which fractal the kernels iterate, each as z -> f(z) + c until |z| > 2:
+ *   FormulaMandelbrot   z^2, with z starting at the pixel c
+ *   FormulaMultibrot3   z^3, the three-lobed Multibrot set
+ *   FormulaMultibrot4   z^4
+ *   FormulaTricorn      conj(z)^2 (the Mandelbar set)
+ *   FormulaBurningShip  (|Re z| + i |Im z|)^2
+ *   FormulaJulia        z^2 with c the fixed Julia constant and z starting
+ *                       at the pixel
+ * Only the Mandelbrot set has the interior tests, the double-double and
+ * perturbation tiers; the others stay in plain doubles.
+**/
+enum FractalFormula {
+	FormulaMandelbrot,
+	FormulaMultibrot3,
+	FormulaMultibrot4,
+	FormulaTricorn,
+	FormulaBurningShip,
+	FormulaJulia,
+};
+
+/**
+ * Command-line names of the formulas: mandelbrot, multibrot3, multibrot4,
+ * tricorn, burningship, julia.
+**/
+const char * FormulaName(FractalFormula formula);
+bool ParseFormula(const char * name, FractalFormula & formula);
+
+static inline double Abs(double a) {
+	return __builtin_fabs(a);
+}
+
+/**
+ * One formula as a type, so that each kernel is compiled once per formula
+ * with the step fully inlined: z is raised to Power (2 to 4), after being
+ * conjugated with Conjugate or folded into the first quadrant with Absolute,
+ * and with Julia the constant takes the place of the pixel.
+ *
+ * Step() and Derivative() are templates over T = double or VecD and write
+ * the power 2 step in the kernels' original operation order, so the
+ * Mandelbrot set still rounds exactly as before.
+**/
+template < int Power, bool Conjugate, bool Absolute, bool Julia >
+struct Formula {
+	static_assert(Power >= 2 && Power <= 4, "powers 2 to 4 only");
+	static constexpr int Degree = Power;
+	static constexpr bool IsJulia = Julia;
+	// The distance estimate needs dz/dc, which only a holomorphic f has.
+	static constexpr bool Holomorphic = !Conjugate && !Absolute;
+	template < typename T >
+	static inline void Step(T & zx, T & zy, T cx, T cy) {
+		const T two = Constant < T > (2.0);
+		T x = Absolute ? Abs(zx) : zx;
+		T y = Absolute ? Abs(zy) : zy;
+		T rx, ry;
+		if(Power == 2) {
+			rx = x * x - y * y;
+			ry = two * x * y;
+		} else if(Power == 3) {
+			const T three = Constant < T > (3.0);
+			rx = x * (x * x - three * y * y);
+			ry = y * (three * x * x - y * y);
+		} else {
+			T sx = x * x - y * y;
+			T sy = two * x * y;
+			rx = sx * sx - sy * sy;
+			ry = two * sx * sy;
+		}
+		zx = rx + cx;
+		zy = Conjugate ? cy - ry : ry + cy;
+	}
+	/**
+	 * dz = f'(z) dz + 1 for a point of the parameter plane, f'(z) dz for a
+	 * Julia set, whose derivative is taken with respect to the start z.
+	**/
+	template < typename T >
+	static inline void Derivative(T zx, T zy, T & dzx, T & dzy) {
+		// z^(Power - 1) dz, scaled by Power.
+		T px = zx, py = zy;
+		for(int k = 2; k < Power; ++k) {
+			T t = px * zx - py * zy;
+			py = px * zy + py * zx;
+			px = t;
+		}
+		T gx = px * dzx - py * dzy;
+		T gy = px * dzy + py * dzx;
+		const T power = Constant < T > (Power);
+		dzx = Julia ? power * gx : power * gx + Constant < T > (1.0);
+		dzy = power * gy;
+	}
+};
+
+typedef Formula < 2, false, false, false > MandelbrotFormula;
+typedef Formula < 3, false, false, false > Multibrot3Formula;
+typedef Formula < 4, false, false, false > Multibrot4Formula;
+typedef Formula < 2, true, false, false > TricornFormula;
+typedef Formula < 2, false, true, false > BurningShipFormula;
+typedef Formula < 2, false, false, true > JuliaFormula;
+
+/**
+ * Calls run(F()) with F the Formula type of formula, so that a caller picks
+ * its kernel once per call instead of testing the formula in the loop.
+**/
+template < typename Run >
+static inline void DispatchFormula(FractalFormula formula, Run run) {
+	switch(formula) {
+		case FormulaMandelbrot:
+			run(MandelbrotFormula());
+			break;
+		case FormulaMultibrot3:
+			run(Multibrot3Formula());
+			break;
+		case FormulaMultibrot4:
+			run(Multibrot4Formula());
+			break;
+		case FormulaTricorn:
+			run(TricornFormula());
+			break;
+		case FormulaBurningShip:
+			run(BurningShipFormula());
+			break;
+		case FormulaJulia:
+			run(JuliaFormula());
+			break;
+	}
+}
+
+static inline int FormulaDegree(FractalFormula formula) {
+	return formula == FormulaMultibrot3 ? 3 : formula == FormulaMultibrot4 ? 4 : 2;
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "frame_pipeline.hpp"
+#include <algorithm>
+#include <sys/resource.h>
+
+FramePipeline::FramePipeline(FrameRing & ring, std::function < void(UBYTE *, FrameInfo &) > render): ring(ring), render(render) {
+	std::vector < int > pending = ring.PendingSlots();
+	readySlots.assign(pending.begin(), pending.end());
+	for(int slot = 0; slot < ring.SlotCount(); ++slot) {
+		if(std::find(pending.begin(), pending.end(), slot) == pending.end()) {
+			freeSlots.push_back(slot);
+		}
+	}
+	producer = std::thread(&FramePipeline::Produce, this);
+}
+
+FramePipeline::~FramePipeline() {
+	{
+		std::lock_guard < std::mutex > lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	producer.join();
+}
+
+UBYTE * FramePipeline::Acquire() {
+	std::unique_lock < std::mutex > lock(mutex);
+	changed.wait(lock, [ & ] {
+		return !readySlots.empty();
+	});
+	int slot = readySlots.front();
+	readySlots.pop_front();
+	return ring.Frame(slot);
+}
+
+void FramePipeline::Release(UBYTE * image) {
+	int slot = ring.SlotOf(image);
+	ring.Consume(slot);
+	{
+		std::lock_guard < std::mutex > lock(mutex);
+		freeSlots.push_back(slot);
+	}
+	changed.notify_all();
+}
+
+void FramePipeline::Produce() {
+	// On Linux the nice value belongs to the calling thread, not the process,
+	// so the display loop keeps its normal priority.
+	setpriority(PRIO_PROCESS, 0, ProducerNice);
+	while(true) {
+		int slot;
+		{
+			std::unique_lock < std::mutex > lock(mutex);
+			changed.wait(lock, [ & ] {
+				return stopping || !freeSlots.empty();
+			});
+			if(stopping) {
+				return;
+			}
+			slot = freeSlots.front();
+			freeSlots.pop_front();
+		}
+		ring.Reserve(slot);
+		FrameInfo info;
+		render(ring.Frame(slot), info);
+		ring.Commit(slot, info);
+		{
+			std::lock_guard < std::mutex > lock(mutex);
+			readySlots.push_back(slot);
+		}
+		changed.notify_all();
+	}
+}
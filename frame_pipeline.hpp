@@ -0,0 +1,51 @@
+#ifndef _FRAME_PIPELINE_HPP_
+#define _FRAME_PIPELINE_HPP_
+
+#include "DEV_Config.h"
+#include "frame_ring.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Renders frames ahead of the display on a background thread.
+ *
+ * A producer thread at the lowest CPU priority calls render(frame, info) on
+ * every free slot of a FrameRing and commits the result; the display loop
+ * takes committed frames in order with Acquire() and hands each slot back
+ * with Release() once the panel has it. Frames the ring kept from the last
+ * run are queued first. With two or more slots the next frame is computed
+ * while the current one is shown, so a slow render only shortens the idle
+ * time before the deadline.
+ *
+ * render is only ever called on the producer thread, which is also where it
+ * should create anything that starts threads of its own (such as a
+ * MandelbrotSet's tile scheduler): new threads inherit the lowered priority.
+**/
+class FramePipeline {
+	public: FramePipeline(FrameRing & ring, std::function < void(UBYTE *, FrameInfo &) > render);
+	~FramePipeline();
+	FramePipeline(const FramePipeline &) = delete;
+	FramePipeline & operator = (const FramePipeline &) = delete;
+	/**
+	 * Blocks until the oldest rendered frame is ready and returns it. The
+	 * buffer is not reused until it is passed to Release().
+	**/
+	UBYTE * Acquire();
+	void Release(UBYTE * image);
+	private: static constexpr int ProducerNice = 19;
+	void Produce();
+	FrameRing & ring;
+	std::function < void(UBYTE *, FrameInfo &) > render;
+	std::deque < int > freeSlots;
+	std::deque < int > readySlots;
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool stopping = false;
+	std::thread producer;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "frame_ring.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct FrameRing::RingHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t slotCount;
+	uint64_t frameBytes;
+};
+
+struct FrameRing::SlotHeader {
+	// 0 while the slot holds no committed frame; written last on commit.
+	uint64_t sequence;
+	uint32_t consumed;
+	uint32_t checksum;
+	FrameInfo info;
+};
+
+static const char RingMagic[8] = {'P', 'A', 'F', 'R', 'I', 'N', 'G', '\0'};
+static constexpr uint32_t RingVersion = 1;
+// Headers are padded to a cache line; slots start on one too.
+static constexpr size_t HeaderBytes = 64;
+
+/**
+ * CRC-32 (IEEE, reflected) continued from crc.
+**/
+static uint32_t Crc32(uint32_t crc, const void * data, size_t bytes) {
+	static uint32_t table[256];
+	static bool ready = false;
+	if(!ready) {
+		for(uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for(int k = 0; k < 8; ++k) {
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		ready = true;
+	}
+	const UBYTE * p = (const UBYTE *) data;
+	crc = ~crc;
+	for(size_t i = 0; i < bytes; ++i) {
+		crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+FrameRing::~FrameRing() {
+	if(base) {
+		munmap(base, mappedBytes);
+	}
+}
+
+bool FrameRing::Open(const char * path, int slotCount, size_t frameBytes) {
+	static_assert(sizeof(RingHeader) <= HeaderBytes && sizeof(SlotHeader) <= HeaderBytes, "headers must fit their padding");
+	this->slotCount = slotCount;
+	this->frameBytes = frameBytes;
+	slotBytes = HeaderBytes + (frameBytes + HeaderBytes - 1) / HeaderBytes * HeaderBytes;
+	mappedBytes = HeaderBytes + slotCount * slotBytes;
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if(fd >= 0) {
+		struct stat status;
+		if(fstat(fd, & status) == 0 && (size_t) status.st_size != mappedBytes) {
+			// A ring of another geometry (or a new file) starts out empty.
+			if(ftruncate(fd, 0) != 0 || ftruncate(fd, mappedBytes) != 0) {
+				close(fd);
+				fd = -1;
+			}
+		}
+	}
+	void * mapping = MAP_FAILED;
+	if(fd >= 0) {
+		mapping = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	}
+	persistent = mapping != MAP_FAILED;
+	if(!persistent) {
+		std::cout << "Cannot map frame ring " << path << ", keeping frames in memory only" << std::endl;
+		mapping = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if(mapping == MAP_FAILED) {
+			base = nullptr;
+			return false;
+		}
+	}
+	base = (UBYTE *) mapping;
+	RingHeader * header = Header();
+	if(memcmp(header->magic, RingMagic, sizeof(RingMagic)) != 0 || header->version != RingVersion || header->slotCount != (uint32_t) slotCount || header->frameBytes != frameBytes) {
+		memset(base, 0, mappedBytes);
+		memcpy(header->magic, RingMagic, sizeof(RingMagic));
+		header->version = RingVersion;
+		header->slotCount = slotCount;
+		header->frameBytes = frameBytes;
+		Sync(base, mappedBytes);
+	}
+	// Drop whatever a crash left half written.
+	int recovered = 0;
+	for(int slot = 0; slot < slotCount; ++slot) {
+		SlotHeader * slotHeader = Slot(slot);
+		if(slotHeader->sequence != 0 && slotHeader->checksum != Checksum(slot)) {
+			slotHeader->sequence = 0;
+			Sync(slotHeader, sizeof(SlotHeader));
+		}
+		nextSequence = std::max(nextSequence, slotHeader->sequence + 1);
+		recovered += slotHeader->sequence != 0 && !slotHeader->consumed;
+	}
+	if(recovered > 0) {
+		std::cout << "Frame ring " << path << ": " << recovered << " frames ready from the last run" << std::endl;
+	}
+	return persistent;
+}
+
+FrameRing::RingHeader * FrameRing::Header() const {
+	return (RingHeader *) base;
+}
+
+FrameRing::SlotHeader * FrameRing::Slot(int slot) const {
+	return (SlotHeader *)(base + HeaderBytes + slot * slotBytes);
+}
+
+UBYTE * FrameRing::Frame(int slot) const {
+	return base + HeaderBytes + slot * slotBytes + HeaderBytes;
+}
+
+const FrameInfo & FrameRing::Info(int slot) const {
+	return Slot(slot)->info;
+}
+
+int FrameRing::SlotOf(const UBYTE * image) const {
+	for(int slot = 0; slot < slotCount; ++slot) {
+		if(Frame(slot) == image) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+std::vector < int > FrameRing::PendingSlots() const {
+	std::vector < int > pending;
+	for(int slot = 0; slot < slotCount; ++slot) {
+		if(Slot(slot)->sequence != 0 && !Slot(slot)->consumed) {
+			pending.push_back(slot);
+		}
+	}
+	std::sort(pending.begin(), pending.end(), [ & ](int a, int b) {
+		return Slot(a)->sequence < Slot(b)->sequence;
+	});
+	return pending;
+}
+
+void FrameRing::Reserve(int slot) {
+	Slot(slot)->sequence = 0;
+	Sync(Slot(slot), sizeof(SlotHeader));
+}
+
+void FrameRing::Commit(int slot, const FrameInfo & info) {
+	SlotHeader * slotHeader = Slot(slot);
+	Sync(Frame(slot), frameBytes);
+	slotHeader->consumed = 0;
+	slotHeader->info = info;
+	slotHeader->checksum = Checksum(slot);
+	slotHeader->sequence = nextSequence++;
+	Sync(slotHeader, sizeof(SlotHeader));
+}
+
+void FrameRing::Consume(int slot) {
+	Slot(slot)->consumed = 1;
+	Sync(Slot(slot), sizeof(SlotHeader));
+}
+
+uint32_t FrameRing::Checksum(int slot) const {
+	uint32_t crc = Crc32(0, Frame(slot), frameBytes);
+	return Crc32(crc, & Slot(slot)->info, sizeof(FrameInfo));
+}
+
+void FrameRing::Sync(const void * address, size_t bytes) const {
+	if(!persistent) {
+		return;
+	}
+	// msync wants a page-aligned start.
+	uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t) address / page * page;
+	msync((void *) start, (uintptr_t) address + bytes - start, MS_SYNC);
+}
@@ -0,0 +1,82 @@
+#ifndef _FRAME_RING_HPP_
+#define _FRAME_RING_HPP_
+
+#include "DEV_Config.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * What a rendered frame shows, stored next to it.
+**/
+struct FrameInfo {
+	double centerX = 0.0;
+	double centerY = 0.0;
+	double width = 0.0;
+	int32_t iterations = 0;
+	float blackRatio = 0.0f;
+};
+
+/**
+ * Fixed number of packed 1bpp frames in a memory-mapped file, so frames that
+ * were rendered ahead survive a reboot and are shown without re-rendering.
+ *
+ * Each slot is a small header (sequence number, FrameInfo, checksum) followed
+ * by the frame, which the renderer writes and the display reads in place.
+ * A slot is committed in this order, each step flushed before the next:
+ *   Reserve  sequence = 0: the slot no longer holds a frame
+ *   (render) the frame bytes are written
+ *   Commit   frame bytes, then FrameInfo and checksum, then the sequence
+ * so after a crash a slot either holds a complete frame whose checksum
+ * matches, or is dropped when the file is opened again. Consume marks a
+ * frame as shown so a restart does not show it twice.
+ *
+ * When the file cannot be opened the ring falls back to anonymous memory:
+ * the same code path, just without persistence.
+**/
+class FrameRing {
+	public: FrameRing() = default;
+	~FrameRing();
+	FrameRing(const FrameRing &) = delete;
+	FrameRing & operator = (const FrameRing &) = delete;
+	/**
+	 * Maps path, creating or reformatting it when its geometry differs.
+	 * Returns false if it had to fall back to memory, and leaves the ring
+	 * closed if not even that could be mapped.
+	**/
+	bool Open(const char * path, int slotCount, size_t frameBytes);
+	bool IsOpen() const {
+		return base != nullptr;
+	};
+	int SlotCount() const {
+		return slotCount;
+	};
+	UBYTE * Frame(int slot) const;
+	const FrameInfo & Info(int slot) const;
+	/**
+	 * Slot whose frame starts at image, or -1.
+	**/
+	int SlotOf(const UBYTE * image) const;
+	/**
+	 * Committed frames not yet consumed, oldest first.
+	**/
+	std::vector < int > PendingSlots() const;
+	void Reserve(int slot);
+	void Commit(int slot, const FrameInfo & info);
+	void Consume(int slot);
+	private: struct RingHeader;
+	struct SlotHeader;
+	RingHeader * Header() const;
+	SlotHeader * Slot(int slot) const;
+	uint32_t Checksum(int slot) const;
+	void Sync(const void * address, size_t bytes) const;
+	UBYTE * base = nullptr;
+	size_t mappedBytes = 0;
+	size_t frameBytes = 0;
+	size_t slotBytes = 0;
+	int slotCount = 0;
+	bool persistent = false;
+	uint64_t nextSequence = 1;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "high_precision.hpp"
+#include <cmath>
+#include <cstdio>
+
+HighPrecision::HighPrecision(double value, int fractionLimbs): negative(value < 0.0), limbs(fractionLimbs + 1, 0) {
+	if(value == 0.0 || !std::isfinite(value)) {
+		negative = false;
+		return;
+	}
+	int exponent;
+	double mantissa = std::frexp(std::fabs(value), &exponent);
+	uint64_t bits = (uint64_t) std::ldexp(mantissa, 53);
+	// Bit k of the 53-bit mantissa has weight 2^(exponent - 53 + k).
+	for(int k = 0; k < 53; ++k) {
+		if(!(bits >> k & 1)) {
+			continue;
+		}
+		int position = exponent - 53 + k + 32 * fractionLimbs;
+		if(position < 0 || position >= 32 * (int) limbs.size()) {
+			continue;
+		}
+		limbs[position / 32] |= 1u << (position % 32);
+	}
+	if(IsZero()) {
+		negative = false;
+	}
+}
+
+int HighPrecision::LimbsForScale(double scale) {
+	int exponent = 0;
+	std::frexp(scale, &exponent);
+	int bits = (exponent < 0 ? -exponent : 0) + 64;
+	return (bits + 31) / 32;
+}
+
+void HighPrecision::SetFractionLimbs(int fractionLimbs) {
+	int shift = fractionLimbs - FractionLimbs();
+	if(shift > 0) {
+		limbs.insert(limbs.begin(), shift, 0);
+	} else if(shift < 0) {
+		limbs.erase(limbs.begin(), limbs.begin() - shift);
+		if(IsZero()) {
+			negative = false;
+		}
+	}
+}
+
+bool HighPrecision::IsZero() const {
+	for(uint32_t limb: limbs) {
+		if(limb) {
+			return false;
+		}
+	}
+	return true;
+}
+
+double HighPrecision::ToDouble() const {
+	int top = (int) limbs.size() - 1;
+	while(top > 0 && limbs[top] == 0) {
+		--top;
+	}
+	if(limbs[top] == 0) {
+		return 0.0;
+	}
+	// The leading 64 bits, with every bit below them folded into the last one
+	// so that the conversion to double is the only rounding.
+	auto limb = [ & ](int k) {
+		return k >= 0 ? limbs[k] : 0u;
+	};
+	int lead = __builtin_clz(limbs[top]);
+	uint64_t mantissa = (uint64_t) limbs[top] << 32 | limb(top - 1);
+	uint32_t next = limb(top - 2);
+	bool sticky = false;
+	if(lead > 0) {
+		mantissa = mantissa << lead | next >> (32 - lead);
+		sticky = (uint32_t)(next << lead) != 0;
+	} else {
+		sticky = next != 0;
+	}
+	for(int k = top - 3; k >= 0 && !sticky; --k) {
+		sticky = limbs[k] != 0;
+	}
+	double value = std::ldexp((double)(mantissa | sticky), 32 * (top - 1 - FractionLimbs()) - lead);
+	return negative ? -value : value;
+}
+
+void HighPrecision::ToDoubleDouble(double & hi, double & lo) const {
+	hi = ToDouble();
+	lo = (* this - HighPrecision(hi, FractionLimbs())).ToDouble();
+}
+
+void HighPrecision::AddDouble(double value) {
+	if(value == 0.0) {
+		return;
+	}
+	int exponent;
+	std::frexp(value, &exponent);
+	int needed = (53 - exponent + 31) / 32;
+	if(needed > FractionLimbs()) {
+		SetFractionLimbs(needed);
+	}
+	* this = * this + HighPrecision(value, FractionLimbs());
+}
+
+int HighPrecision::CompareMagnitude(const std::vector < uint32_t > & a, const std::vector < uint32_t > & b) {
+	for(int k = (int) a.size() - 1; k >= 0; --k) {
+		if(a[k] != b[k]) {
+			return a[k] < b[k] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+HighPrecision HighPrecision::AddSigned(const HighPrecision & a, const HighPrecision & b, bool negateB) {
+	int fractionLimbs = a.FractionLimbs() > b.FractionLimbs() ? a.FractionLimbs() : b.FractionLimbs();
+	HighPrecision x = a;
+	HighPrecision y = b;
+	x.SetFractionLimbs(fractionLimbs);
+	y.SetFractionLimbs(fractionLimbs);
+	bool yNegative = y.negative != negateB;
+	HighPrecision result;
+	result.limbs.assign(fractionLimbs + 1, 0);
+	if(x.negative == yNegative) {
+		uint64_t carry = 0;
+		for(size_t k = 0; k < result.limbs.size(); ++k) {
+			uint64_t sum = (uint64_t) x.limbs[k] + y.limbs[k] + carry;
+			result.limbs[k] = (uint32_t) sum;
+			carry = sum >> 32;
+		}
+		result.negative = x.negative;
+	} else {
+		const HighPrecision * larger = &x;
+		const HighPrecision * smaller = &y;
+		result.negative = x.negative;
+		if(CompareMagnitude(x.limbs, y.limbs) < 0) {
+			larger = &y;
+			smaller = &x;
+			result.negative = yNegative;
+		}
+		int64_t borrow = 0;
+		for(size_t k = 0; k < result.limbs.size(); ++k) {
+			int64_t difference = (int64_t) larger->limbs[k] - smaller->limbs[k] - borrow;
+			borrow = difference < 0;
+			result.limbs[k] = (uint32_t) (difference + (borrow << 32));
+		}
+	}
+	if(result.IsZero()) {
+		result.negative = false;
+	}
+	return result;
+}
+
+HighPrecision operator + (const HighPrecision & a, const HighPrecision & b) {
+	return HighPrecision::AddSigned(a, b, false);
+}
+
+HighPrecision operator - (const HighPrecision & a, const HighPrecision & b) {
+	return HighPrecision::AddSigned(a, b, true);
+}
+
+HighPrecision operator * (const HighPrecision & a, const HighPrecision & b) {
+	int fractionLimbs = a.FractionLimbs() > b.FractionLimbs() ? a.FractionLimbs() : b.FractionLimbs();
+	HighPrecision x = a;
+	HighPrecision y = b;
+	x.SetFractionLimbs(fractionLimbs);
+	y.SetFractionLimbs(fractionLimbs);
+	size_t n = x.limbs.size();
+	// Full product has 2n limbs with 2 * fractionLimbs of them below the point;
+	// the lowest fractionLimbs are dropped.
+	std::vector < uint32_t > product(2 * n, 0);
+	for(size_t i = 0; i < n; ++i) {
+		if(x.limbs[i] == 0) {
+			continue;
+		}
+		uint64_t carry = 0;
+		for(size_t j = 0; j < n; ++j) {
+			uint64_t t = (uint64_t) x.limbs[i] * y.limbs[j] + product[i + j] + carry;
+			product[i + j] = (uint32_t) t;
+			carry = t >> 32;
+		}
+		product[i + n] = (uint32_t) carry;
+	}
+	HighPrecision result;
+	result.limbs.assign(product.begin() + fractionLimbs, product.begin() + fractionLimbs + n);
+	result.negative = (x.negative != y.negative) && !result.IsZero();
+	return result;
+}
+
+std::string HighPrecision::ToString() const {
+	std::string text = negative ? "-" : "+";
+	char limb[9];
+	for(int k = (int) limbs.size() - 1; k >= 0; --k) {
+		snprintf(limb, sizeof(limb), "%08x", limbs[k]);
+		text += limb;
+		if(k == FractionLimbs()) {
+			text += '.';
+		}
+	}
+	return text;
+}
+
+bool HighPrecision::FromString(const std::string & text, HighPrecision & value) {
+	size_t point = text.find('.');
+	if(text.size() < 10 || (text[0] != '+' && text[0] != '-') || point != 9 || (text.size() - point - 1) % 8 != 0) {
+		return false;
+	}
+	HighPrecision parsed;
+	parsed.negative = text[0] == '-';
+	int fractionLimbs = (int) (text.size() - point - 1) / 8;
+	parsed.limbs.assign(fractionLimbs + 1, 0);
+	for(int k = 0; k <= fractionLimbs; ++k) {
+		size_t offset = k == 0 ? 1 : point + 1 + 8 * (k - 1);
+		unsigned long limb;
+		char * end;
+		std::string digits = text.substr(offset, 8);
+		limb = strtoul(digits.c_str(), &end, 16);
+		if(* end != '\0') {
+			return false;
+		}
+		parsed.limbs[fractionLimbs - k] = (uint32_t) limb;
+	}
+	if(parsed.IsZero()) {
+		parsed.negative = false;
+	}
+	value = parsed;
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef _HIGH_PRECISION_HPP_
+#define _HIGH_PRECISION_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Signed fixed-point number with a 32-bit integer part and a variable number
+ * of 32-bit fraction limbs. Used for the view centre and the perturbation
+ * reference orbit, where double runs out of bits below widths of ~1e-15.
+ *
+ * Limbs are little-endian: limbs[0] is the least significant fraction limb
+ * and limbs.back() the integer part. Results of + - * carry the larger of the
+ * operands' precisions and are truncated, not rounded.
+**/
+class HighPrecision {
+	public: HighPrecision(): negative(false), limbs(1, 0) {}
+	HighPrecision(double value, int fractionLimbs);
+	/**
+	 * Fraction limbs needed to resolve steps of `scale` with 64 guard bits.
+	**/
+	static int LimbsForScale(double scale);
+	int FractionLimbs() const {
+		return (int) limbs.size() - 1;
+	};
+	void SetFractionLimbs(int fractionLimbs);
+	/**
+	 * The nearest double, rounded once.
+	**/
+	double ToDouble() const;
+	/**
+	 * Splits into hi + lo with hi the nearest double and lo the rounded rest.
+	**/
+	void ToDoubleDouble(double & hi, double & lo) const;
+	/**
+	 * Adds a double exactly, widening the fraction as far as the double needs.
+	**/
+	void AddDouble(double value);
+	std::string ToString() const;
+	static bool FromString(const std::string & text, HighPrecision & value);
+	friend HighPrecision operator + (const HighPrecision & a, const HighPrecision & b);
+	friend HighPrecision operator - (const HighPrecision & a, const HighPrecision & b);
+	friend HighPrecision operator * (const HighPrecision & a, const HighPrecision & b);
+	private: static int CompareMagnitude(const std::vector < uint32_t > & a, const std::vector < uint32_t > & b);
+	static HighPrecision AddSigned(const HighPrecision & a, const HighPrecision & b, bool negateB);
+	bool IsZero() const;
+	bool negative;
+	std::vector < uint32_t > limbs;
+};
+
+#endif
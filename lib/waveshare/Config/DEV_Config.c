@@ -28,7 +28,9 @@
 #
 ******************************************************************************/
 #include "DEV_Config.h"
+#ifdef RPI
 #include "RPI_gpiod.h"
+#endif
 
 #if USE_LGPIO_LIB
 int GPIO_Handle;
@@ -68,6 +70,10 @@ void DEV_Digital_Write(UWORD Pin, UBYTE Value)
 	Debug("not support");
 #endif
 #endif
+
+#ifdef HOST
+	HOST_GPIO_Write(Pin, Value);
+#endif
 }
 
 UBYTE DEV_Digital_Read(UWORD Pin)
@@ -91,6 +97,10 @@ UBYTE DEV_Digital_Read(UWORD Pin)
 #elif USE_HARDWARE_LIB
 	Debug("not support");
 #endif
+#endif
+
+#ifdef HOST
+	Read_value = HOST_GPIO_Read(Pin);
 #endif
 	return Read_value;
 }
@@ -119,6 +129,10 @@ void DEV_SPI_WriteByte(uint8_t Value)
 	Debug("not support");
 #endif
 #endif
+
+#ifdef HOST
+	HOST_SPI_Transfer(&Value, 1);
+#endif
 }
 
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
@@ -147,6 +161,10 @@ void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
 	Debug("not support");
 #endif
 #endif
+
+#ifdef HOST
+	HOST_SPI_Transfer(pData, Len);
+#endif
 }
 
 /**
@@ -224,10 +242,19 @@ void DEV_Delay_ms(UDOUBLE xms)
 		usleep(1000);
 	}
 #endif
+
+#ifdef HOST
+	HOST_Delay_ms(xms);
+#endif
 }
 
 static int DEV_Equipment_Testing(void)
 {
+#ifdef HOST
+	// No /etc/issue check: the host backend runs on any Linux.
+	printf("Current environment: host, simulated panel\n");
+	return 0;
+#endif
 	FILE *fp;
 	char issue_str[64];
 
@@ -290,6 +317,12 @@ void DEV_GPIO_Init(void)
 	EPD_CS_PIN      = SPI0_CS0;
     EPD_PWR_PIN     = GPIO18;
 	EPD_BUSY_PIN    = GPIO24;
+#elif HOST
+	EPD_RST_PIN     = 17;
+	EPD_DC_PIN      = 25;
+	EPD_CS_PIN      = 8;
+    EPD_PWR_PIN     = 18;
+	EPD_BUSY_PIN    = 24;
 #endif
 
     DEV_GPIO_Mode(EPD_BUSY_PIN, 0);
@@ -397,6 +430,9 @@ UBYTE DEV_Module_Init(void)
 	DEV_HARDWARE_SPI_begin("/dev/spidev0.0");
 #endif
 
+#elif HOST
+	DEV_GPIO_Init();
+	HOST_Begin(EPD_BUSY_PIN, EPD_DC_PIN);
 #endif
     printf("/***********************************/ \r\n");
 	return 0;
@@ -453,5 +489,12 @@ void DEV_Module_Exit(void)
 #elif USE_HARDWARE_LIB
 	Debug("not support");
 #endif
+
+#elif HOST
+	DEV_Digital_Write(EPD_CS_PIN, 0);
+    DEV_Digital_Write(EPD_PWR_PIN, 0);
+	DEV_Digital_Write(EPD_DC_PIN, 0);
+	DEV_Digital_Write(EPD_RST_PIN, 0);
+	HOST_End();
 #endif
 }
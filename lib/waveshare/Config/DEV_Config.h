@@ -82,6 +82,10 @@
 
 #endif
 
+#ifdef HOST
+    #include "host_gpio.h"
+#endif
+
 /**
  * data
 **/
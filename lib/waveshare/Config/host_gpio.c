@@ -0,0 +1,256 @@
+/*****************************************************************************
+* | File        :   host_gpio.c
+* | Function    :   Simulated GPIO and SPI for building on a Linux host
+* | Info        :   Records SPI bytes and GPIO transitions in memory and
+*                   drives the BUSY pin from a refresh-time model
+*----------------
+* |	This version:   V1.0
+* | Info        :   Basic version
+*
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documnetation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to  whom the Software is
+# furished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS OR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+******************************************************************************/
+#include "host_gpio.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint32_t Busy_Ms[256];
+static uint8_t Busy_Level = 0;
+static double Time_Scale = 1.0;
+
+static int Busy_Pin = -1;
+static int DC_Pin = -1;
+static uint8_t Pin_Value[HOST_PINS];
+static uint64_t Busy_Until_us = 0;
+static HOST_Stats Stats;
+static HOST_Stats Cycle_Start;
+
+static uint8_t *SPI_Log = NULL;
+static uint32_t SPI_Log_Len = 0;
+static uint32_t SPI_Log_Cap = 0;
+static HOST_GPIO_Transition *GPIO_Log = NULL;
+static uint32_t GPIO_Log_Count = 0;
+static uint32_t GPIO_Log_Cap = 0;
+
+/**
+ * Grows *buffer to hold need items of size bytes, doubling up to
+ * HOST_LOG_LIMIT bytes. Returns 0 once the limit or memory runs out.
+**/
+static int HOST_Reserve(void **buffer, uint32_t *cap, uint32_t need, uint32_t size)
+{
+	if(need <= *cap) {
+		return 1;
+	}
+	if((uint64_t)need * size > HOST_LOG_LIMIT) {
+		return 0;
+	}
+	uint64_t next = *cap ? *cap : 4096;
+	while(next < need) {
+		next *= 2;
+	}
+	if(next * size > HOST_LOG_LIMIT) {
+		next = HOST_LOG_LIMIT / size;
+	}
+	void *grown = realloc(*buffer, next * size);
+	if(grown == NULL) {
+		return 0;
+	}
+	*buffer = grown;
+	*cap = (uint32_t)next;
+	return 1;
+}
+
+void HOST_Set_Busy_Time(uint8_t command, uint32_t busy_ms)
+{
+	Busy_Ms[command] = busy_ms;
+}
+
+void HOST_Set_Busy_Level(uint8_t level)
+{
+	Busy_Level = level ? 1 : 0;
+}
+
+void HOST_Set_Time_Scale(double scale)
+{
+	Time_Scale = scale > 0 ? scale : 0;
+}
+
+/**
+ * Reads HOST_BUSY_MS ("12:3500,04:100") and HOST_TIME_SCALE
+**/
+static void HOST_Read_Environment(void)
+{
+	const char *busy = getenv("HOST_BUSY_MS");
+	while(busy != NULL && *busy) {
+		char *end;
+		unsigned long command = strtoul(busy, &end, 16);
+		if(end == busy || *end != ':' || command > 0xFF) {
+			printf("HOST_BUSY_MS: expected command:ms pairs, ignoring \"%s\"\r\n", busy);
+			break;
+		}
+		busy = end + 1;
+		unsigned long ms = strtoul(busy, &end, 10);
+		if(end == busy) {
+			printf("HOST_BUSY_MS: missing time for command 0x%02lx\r\n", command);
+			break;
+		}
+		Busy_Ms[command] = (uint32_t)ms;
+		busy = *end == ',' ? end + 1 : end;
+	}
+	const char *scale = getenv("HOST_TIME_SCALE");
+	if(scale != NULL) {
+		HOST_Set_Time_Scale(atof(scale));
+	}
+}
+
+void HOST_Begin(int busy_pin, int dc_pin)
+{
+	// Typical figures of the 7.5" V2: full refresh and power on.
+	if(Busy_Ms[0x12] == 0) {
+		Busy_Ms[0x12] = 3500;
+	}
+	if(Busy_Ms[0x04] == 0) {
+		Busy_Ms[0x04] = 100;
+	}
+	HOST_Read_Environment();
+	Busy_Pin = busy_pin;
+	DC_Pin = dc_pin;
+	memset(Pin_Value, 0, sizeof(Pin_Value));
+	memset(&Stats, 0, sizeof(Stats));
+	Cycle_Start = Stats;
+	Busy_Until_us = 0;
+	HOST_Clear_Log();
+	printf("Host GPIO: BUSY %s while busy, time scale %g\r\n", Busy_Level ? "high" : "low", Time_Scale);
+}
+
+void HOST_End(void)
+{
+	HOST_Stats zero;
+	memset(&zero, 0, sizeof(zero));
+	HOST_Print_Stats(stdout, "total", zero);
+	free(SPI_Log);
+	free(GPIO_Log);
+	SPI_Log = NULL;
+	GPIO_Log = NULL;
+	SPI_Log_Len = SPI_Log_Cap = 0;
+	GPIO_Log_Count = GPIO_Log_Cap = 0;
+}
+
+void HOST_GPIO_Write(int pin, uint8_t value)
+{
+	if(pin < 0 || pin >= HOST_PINS) {
+		return;
+	}
+	value = value ? 1 : 0;
+	if(Pin_Value[pin] == value) {
+		return;
+	}
+	Pin_Value[pin] = value;
+	Stats.transitions++;
+	if(HOST_Reserve((void **)&GPIO_Log, &GPIO_Log_Cap, GPIO_Log_Count + 1, sizeof(HOST_GPIO_Transition))) {
+		HOST_GPIO_Transition *transition = &GPIO_Log[GPIO_Log_Count++];
+		transition->time_us = Stats.clock_us;
+		transition->pin = (uint16_t)pin;
+		transition->value = value;
+	}
+}
+
+uint8_t HOST_GPIO_Read(int pin)
+{
+	if(pin == Busy_Pin) {
+		return Stats.clock_us < Busy_Until_us ? Busy_Level : !Busy_Level;
+	}
+	if(pin < 0 || pin >= HOST_PINS) {
+		return 0;
+	}
+	return Pin_Value[pin];
+}
+
+void HOST_SPI_Transfer(const uint8_t *data, uint32_t len)
+{
+	int command = DC_Pin >= 0 && DC_Pin < HOST_PINS && Pin_Value[DC_Pin] == 0;
+	if(command) {
+		for(uint32_t i = 0; i < len; i++) {
+			Stats.commands++;
+			uint32_t busy_ms = Busy_Ms[data[i]];
+			if(busy_ms > 0) {
+				Stats.busy_waits++;
+				Stats.busy_us += (uint64_t)busy_ms * 1000;
+				Busy_Until_us = Stats.clock_us + (uint64_t)busy_ms * 1000;
+			}
+			if(data[i] == HOST_SLEEP_COMMAND) {
+				HOST_Print_Stats(stdout, "refresh cycle", Cycle_Start);
+				Cycle_Start = Stats;
+			}
+		}
+	} else {
+		Stats.spi_data_bytes += len;
+	}
+	Stats.spi_bytes += len;
+	Stats.clock_us += (uint64_t)len * 8 * 1000000 / HOST_SPI_HZ;
+	if(HOST_Reserve((void **)&SPI_Log, &SPI_Log_Cap, SPI_Log_Len + len, 1)) {
+		memcpy(SPI_Log + SPI_Log_Len, data, len);
+		SPI_Log_Len += len;
+	}
+}
+
+void HOST_Delay_ms(uint32_t ms)
+{
+	Stats.clock_us += (uint64_t)ms * 1000;
+	if(Time_Scale > 0) {
+		usleep((useconds_t)(ms * 1000.0 * Time_Scale));
+	}
+}
+
+const uint8_t *HOST_SPI_Log(uint32_t *len)
+{
+	*len = SPI_Log_Len;
+	return SPI_Log;
+}
+
+const HOST_GPIO_Transition *HOST_GPIO_Log(uint32_t *count)
+{
+	*count = GPIO_Log_Count;
+	return GPIO_Log;
+}
+
+void HOST_Clear_Log(void)
+{
+	SPI_Log_Len = 0;
+	GPIO_Log_Count = 0;
+}
+
+HOST_Stats HOST_Get_Stats(void)
+{
+	return Stats;
+}
+
+/**
+ * Prints the counters accumulated since the snapshot `since`
+**/
+void HOST_Print_Stats(FILE *out, const char *label, HOST_Stats since)
+{
+	fprintf(out, "Host GPIO %s: %llu SPI bytes (%llu data, %llu commands), %llu pin transitions, %llu busy periods, %.3f s busy of %.3f s simulated\r\n", label,
+		(unsigned long long)(Stats.spi_bytes - since.spi_bytes), (unsigned long long)(Stats.spi_data_bytes - since.spi_data_bytes),
+		(unsigned long long)(Stats.commands - since.commands), (unsigned long long)(Stats.transitions - since.transitions),
+		(unsigned long long)(Stats.busy_waits - since.busy_waits),
+		(Stats.busy_us - since.busy_us) / 1e6, (Stats.clock_us - since.clock_us) / 1e6);
+}
@@ -0,0 +1,105 @@
+/*****************************************************************************
+* | File        :   host_gpio.h
+* | Function    :   Simulated GPIO and SPI for building on a Linux host
+* | Info        :   Records SPI bytes and GPIO transitions in memory and
+*                   drives the BUSY pin from a refresh-time model, so that
+*                   main.c and the EPD drivers run without a panel
+*----------------
+* |	This version:   V1.0
+* | Info        :   Basic version
+*
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documnetation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to  whom the Software is
+# furished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS OR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+******************************************************************************/
+#ifndef __HOST_GPIO_
+#define __HOST_GPIO_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define HOST_PINS 64
+#ifndef HOST_LOG_LIMIT
+	#define HOST_LOG_LIMIT (16u << 20)
+#endif
+// SPI clock the transfer time is charged at, as opened by DEV_Module_Init
+#define HOST_SPI_HZ 10000000
+// Deep sleep ends each refresh cycle; its cost is printed there
+#define HOST_SLEEP_COMMAND 0x07
+
+/**
+ * One change of an output pin, at simulated time time_us
+**/
+typedef struct {
+	uint64_t time_us;
+	uint16_t pin;
+	uint8_t value;
+} HOST_GPIO_Transition;
+
+/**
+ * Totals since HOST_Begin, kept even once the logs are full
+**/
+typedef struct {
+	uint64_t spi_bytes;
+	uint64_t spi_data_bytes;
+	uint64_t commands;
+	uint64_t transitions;
+	uint64_t busy_waits;
+	// Simulated time BUSY was held, and the simulated clock
+	uint64_t busy_us;
+	uint64_t clock_us;
+} HOST_Stats;
+
+/**
+ * Refresh-time model: after command byte `command` (sent with DC low) the
+ * BUSY pin stays at its busy level for busy_ms of simulated time.
+ * Models 0x12 (display refresh) and 0x04 (power on) of the 7.5" V2 by
+ * default. The HOST_BUSY_MS environment variable overrides or adds entries
+ * as "12:3500,04:100" (hexadecimal command, milliseconds).
+**/
+void HOST_Set_Busy_Time(uint8_t command, uint32_t busy_ms);
+/**
+ * Level BUSY reads while the panel is busy; the 7.5" V2 pulls it low.
+**/
+void HOST_Set_Busy_Level(uint8_t level);
+/**
+ * Wall-clock seconds slept per simulated second: 1 runs in real time, 0
+ * only advances the simulated clock. HOST_TIME_SCALE sets it at start-up.
+**/
+void HOST_Set_Time_Scale(double scale);
+
+void HOST_Begin(int busy_pin, int dc_pin);
+void HOST_End(void);
+
+void HOST_GPIO_Write(int pin, uint8_t value);
+uint8_t HOST_GPIO_Read(int pin);
+void HOST_SPI_Transfer(const uint8_t *data, uint32_t len);
+void HOST_Delay_ms(uint32_t ms);
+
+/**
+ * Recorded SPI bytes and GPIO transitions, oldest first. Each log stops
+ * growing at HOST_LOG_LIMIT bytes and starts over after HOST_Clear_Log.
+**/
+const uint8_t *HOST_SPI_Log(uint32_t *len);
+const HOST_GPIO_Transition *HOST_GPIO_Log(uint32_t *count);
+void HOST_Clear_Log(void);
+HOST_Stats HOST_Get_Stats(void);
+void HOST_Print_Stats(FILE *out, const char *label, HOST_Stats since);
+
+#endif
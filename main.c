@@ -6,16 +6,51 @@
 #include <iostream>
 #include <chrono>
 #include "mandelbrot.hpp"
+#include "frame_pipeline.hpp"
+#include <memory>
+#include <random>
+#include <thread>
+#include <cstring>
 
 using namespace std;
 using namespace chrono;
 static constexpr unsigned long SecondsBetweenImages = 60 * 60;
+// Frames rendered ahead, kept on the SD card across restarts.
+static const char * const FrameRingFile = "piArtFrame.ring";
+static constexpr int FrameRingSlots = 4;
+// Exploration state, rewritten after every frame so a restart zooms on.
+static const char * const StateFile = "piArtFrame.state";
 void Handler(int signo) {
 	printf("\r\nHandler:exit\r\n");
 	DEV_Module_Exit();
 	exit(0);
 }
-int main(void) {
+int main(int argc, char * argv[]) {
+	// --seed N replays a run: the same seed from the top gives the same frames.
+	bool replay = false;
+	uint64_t seed = ((uint64_t) random_device()() << 32) ^ (uint64_t) time(NULL);
+	// --dither fs|atkinson|sierra|bayer|bluenoise shades the outside of the set by escape time.
+	DitherMode dither = DitherNone;
+	// --antialias 4|16 supersamples the dithered boundary pixels.
+	int antialias = 1;
+	// --distance P keeps filaments within P pixels of the set black (0.5 is a good start).
+	double distance = 0.0;
+	// --formula multibrot3|multibrot4|tricorn|burningship|julia explores another fractal.
+	FractalFormula formula = FormulaMandelbrot;
+	for(int arg = 1; arg < argc; ++arg) {
+		if(strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+			seed = strtoull(argv[++arg], NULL, 0);
+			replay = true;
+		} else if(strcmp(argv[arg], "--antialias") == 0 && arg + 1 < argc) {
+			antialias = atoi(argv[++arg]);
+		} else if(strcmp(argv[arg], "--distance") == 0 && arg + 1 < argc) {
+			distance = atof(argv[++arg]);
+		} else if(strcmp(argv[arg], "--formula") == 0 && arg + 1 < argc && ParseFormula(argv[++arg], formula)) {
+		} else if(strcmp(argv[arg], "--dither") != 0 || arg + 1 >= argc || !ParseDitherMode(argv[++arg], dither)) {
+			printf("Usage: %s [--seed N] [--dither fs|atkinson|sierra|bayer|bluenoise] [--antialias 4|16] [--distance P] [--formula mandelbrot|multibrot3|multibrot4|tricorn|burningship|julia]\r\n", argv[0]);
+			return -1;
+		}
+	}
 	signal(SIGINT, Handler);
 	if(DEV_Module_Init() != 0) {
 		return -1;
@@ -25,32 +60,58 @@ int main(void) {
 	EPD_7IN5_V2_Clear();
 	DEV_Delay_ms(500);
 	UWORD ImageSize = ((EPD_7IN5_V2_WIDTH % 8 == 0) ? (EPD_7IN5_V2_WIDTH / 8) : (EPD_7IN5_V2_WIDTH / 8 + 1)) * EPD_7IN5_V2_HEIGHT;
-	UBYTE * img = NULL;
-	if((img = (UBYTE * ) malloc(ImageSize)) == NULL) {
-		printf("Failed to apply for image memory...\r\n");
+	FrameRing ring;
+	ring.Open(FrameRingFile, FrameRingSlots, ImageSize);
+	if(!ring.IsOpen()) {
+		printf("Cannot allocate the frame ring\r\n");
+		EPD_7IN5_V2_Sleep();
+		DEV_Module_Exit();
 		return -1;
 	}
-	Paint_NewImage(img, EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT, 0, WHITE);
-	Paint_SelectImage(img);
-	MandelbrotSet mandelbrot;
-	mandelbrot.InitMandelbrotSet();
-	mandelbrot.SetRender(img);
-	bool isFirstImage = true;
-	unsigned int numberOfZooms = 1;
-	while(true) {
-		steady_clock::time_point beforeRender = steady_clock::now();
+	std::unique_ptr < MandelbrotSet > mandelbrot;
+	FramePipeline pipeline(ring, [ & ](UBYTE * image, FrameInfo & info) {
+		if(!mandelbrot) {
+			// Created on the producer thread so that its render threads inherit
+			// the producer's low priority.
+			mandelbrot.reset(new MandelbrotSet());
+			mandelbrot->SetFormula(formula);
+			mandelbrot->InitMandelbrotSet();
+			mandelbrot->SetSeed(seed);
+			// A replay starts from the top; otherwise zoom on where the last run stopped.
+			if(replay || !mandelbrot->LoadState(StateFile)) {
+				cout << "Exploration seed " << seed << " (replay with --seed " << seed << ")" << endl;
+			}
+			mandelbrot->SetRenderMode(RenderSubdivision);
+			mandelbrot->SetDitherMode(dither);
+			mandelbrot->SetAntialiasing(antialias);
+			mandelbrot->SetDistanceEstimation(distance);
+		}
+		Paint_NewImage(image, EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT, 0, WHITE);
+		Paint_SelectImage(image);
+		mandelbrot->SetRender(image);
 		cout << "Starting render..." << endl;
-		mandelbrot.Render(EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT);
+		mandelbrot->Render(EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT);
 		cout << "Render complete!" << endl;
-		steady_clock::time_point afterRender = steady_clock::now();
-		if(!isFirstImage) {
-			while(duration_cast < std::chrono::seconds > (afterRender - beforeRender).count() < static_cast < long > (SecondsBetweenImages)) {
-				sleep(5);
-				afterRender = steady_clock::now();
+		info = mandelbrot->GetFrameInfo();
+		if(mandelbrot->IsZoomExhausted()) {
+			mandelbrot->InitMandelbrotSet();
+		}
+		mandelbrot->SaveState(StateFile);
+	});
+	bool isFirstImage = true;
+	steady_clock::time_point deadline;
+	while(true) {
+		UBYTE * img = pipeline.Acquire();
+		steady_clock::time_point ready = steady_clock::now();
+		if(isFirstImage || ready > deadline) {
+			if(!isFirstImage) {
+				cout << "Frame late by " << duration_cast < std::chrono::seconds > (ready - deadline).count() << " s" << endl;
 			}
+			deadline = ready;
 		} else {
-			isFirstImage = false;
+			this_thread::sleep_until(deadline);
 		}
+		isFirstImage = false;
 		cout << "Drawing image..." << endl;
 		EPD_7IN5_V2_Init();
 		EPD_7IN5_V2_Clear();
@@ -58,10 +119,8 @@ int main(void) {
 		EPD_7IN5_V2_Display(img);
 		EPD_7IN5_V2_Sleep();
 		cout << "Draw completed!" << endl;
-		if(numberOfZooms % 50 == 0) {
-			mandelbrot.InitMandelbrotSet();
-		}
-		numberOfZooms++;
+		pipeline.Release(img);
+		deadline += std::chrono::seconds(SecondsBetweenImages);
 	}
 	return 0;
 }
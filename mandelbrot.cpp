@@ -1,75 +1,840 @@
 #include "mandelbrot.hpp"
 #include "GUI_Paint.h"
-#include <random>
-#include <thread>
+#include "escape_kernel.hpp"
+#include "tile_scheduler.hpp"
+#include "double_double.hpp"
 #include <vector>
-#include <mutex>
+#include <cstring>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
 
 void MandelbrotSet::SetRender(UBYTE * image) {
 	rendered = image;
 }
 
 void MandelbrotSet::InitMandelbrotSet() {
+	// Centre of the whole fractal, per FractalFormula.
+	static const double Starts[][2] = {{-1.0, 0.0}, {0.0, 0.0}, {-0.1, 0.0}, {-0.3, 0.0}, {-0.5, -0.5}, {0.0, 0.0}};
 	w = 4.0;
 	h = 2.0;
 	if(renderedResX > 0 && renderedResY > 0) {
 		double aspectRatio = (double) renderedResX / (double) renderedResY;
 		h = w / aspectRatio;
 	}
-	x = -1.0;
-	y = 0.0;
+	SetCenter(Starts[kernelOptions.formula][0], Starts[kernelOptions.formula][1]);
 	renderedResX = 0;
 	renderedResY = 0;
-	srand(time(0));
+	zoomCount = 0;
 }
-bool MandelbrotSet::IsMandelPoint(double fX, double fY, int iterations) {
-	double z_x = fX;
-	double z_y = fY;
-	for(int i = 0; i < iterations; ++i) {
-		double z_x_old = z_x;
-		z_x = z_x * z_x - z_y * z_y + fX;
-		z_y = 2.0 * z_x_old * z_y + fY;
-		if(z_x * z_x + z_y * z_y > 4.0) {
-			return false;
+
+void MandelbrotSet::SetView(double centerX, double centerY, double width) {
+	SetCenter(centerX, centerY);
+	w = width;
+	h = width;
+	// Render the view as it is rather than zooming away from it.
+	imageIndex = 0;
+	viewFixed = true;
+}
+
+bool MandelbrotSet::SaveState(const char * path) {
+	uint64_t rngState[4];
+	rng.GetState(rngState);
+	std::string temporary = std::string(path) + ".tmp";
+	FILE * file = fopen(temporary.c_str(), "w");
+	if(!file) {
+		std::cout << "Cannot write state file " << temporary << std::endl;
+		return false;
+	}
+	fprintf(file, "%s %d\n", StateMagic, StateVersion);
+	fprintf(file, "centerReal %s\n", centerReal.ToString().c_str());
+	fprintf(file, "centerImag %s\n", centerImag.ToString().c_str());
+	fprintf(file, "width %a\n", w);
+	fprintf(file, "height %a\n", h);
+	fprintf(file, "zooms %llu\n", zoomCount);
+	fprintf(file, "rng %016llx %016llx %016llx %016llx\n", (unsigned long long) rngState[0], (unsigned long long) rngState[1], (unsigned long long) rngState[2], (unsigned long long) rngState[3]);
+	fprintf(file, "tier %d\n", (int) precisionTier);
+	fprintf(file, "formula %s %a %a\n", FormulaName(kernelOptions.formula), kernelOptions.juliaX, kernelOptions.juliaY);
+	bool written = fflush(file) == 0 && fsync(fileno(file)) == 0;
+	written = fclose(file) == 0 && written;
+	// rename() replaces the old file in one step, so a crash leaves either
+	// the previous state or the new one.
+	if(!written || rename(temporary.c_str(), path) != 0) {
+		std::cout << "Cannot write state file " << path << std::endl;
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MandelbrotSet::LoadState(const char * path) {
+	std::ifstream file(path);
+	if(!file) {
+		return false;
+	}
+	std::string magic;
+	int version = 0;
+	file >> magic >> version;
+	HighPrecision real, imag;
+	double width = 0.0, height = 0.0;
+	unsigned long long zooms = 0;
+	uint64_t rngState[4] = {0, 0, 0, 0};
+	int tier = -1;
+	// Files from before the formulas hold a Mandelbrot set view.
+	FractalFormula formula = FormulaMandelbrot;
+	double juliaX = kernelOptions.juliaX, juliaY = kernelOptions.juliaY;
+	unsigned found = 0;
+	std::string line;
+	while(std::getline(file, line)) {
+		std::istringstream fields(line);
+		std::string key, value;
+		if(!(fields >> key >> value)) {
+			continue;
+		}
+		if(key == "centerReal" && HighPrecision::FromString(value, real)) {
+			found |= 1;
+		} else if(key == "centerImag" && HighPrecision::FromString(value, imag)) {
+			found |= 2;
+		} else if(key == "width") {
+			width = strtod(value.c_str(), nullptr);
+			found |= 4;
+		} else if(key == "height") {
+			height = strtod(value.c_str(), nullptr);
+			found |= 8;
+		} else if(key == "zooms") {
+			zooms = strtoull(value.c_str(), nullptr, 10);
+			found |= 16;
+		} else if(key == "rng") {
+			rngState[0] = strtoull(value.c_str(), nullptr, 16);
+			for(int k = 1; k < 4 && fields >> value; ++k) {
+				rngState[k] = strtoull(value.c_str(), nullptr, 16);
+			}
+			// An all-zero state would make xoshiro return zeros forever.
+			if(rngState[0] | rngState[1] | rngState[2] | rngState[3]) {
+				found |= 32;
+			}
+		} else if(key == "tier") {
+			tier = atoi(value.c_str());
+			found |= 64;
+		} else if(key == "formula" && ParseFormula(value.c_str(), formula)) {
+			fields >> juliaX >> juliaY;
+		}
+	}
+	bool valid = magic == StateMagic && version == StateVersion && found == 127 && width > 0.0 && height > 0.0 && tier >= PrecisionDouble && tier <= PrecisionPerturbation;
+	if(!valid) {
+		std::cout << "Ignoring unreadable state file " << path << std::endl;
+		return false;
+	}
+	if(formula != kernelOptions.formula || (formula == FormulaJulia && (juliaX != kernelOptions.juliaX || juliaY != kernelOptions.juliaY))) {
+		std::cout << "Ignoring state file " << path << " of another fractal (" << FormulaName(formula) << ")" << std::endl;
+		return false;
+	}
+	centerReal = real;
+	centerImag = imag;
+	MoveCenter(0.0, 0.0);
+	w = width;
+	h = height;
+	zoomCount = zooms;
+	precisionTier = (PrecisionTier) tier;
+	rng.SetState(rngState);
+	// The stored view has been shown; the next render zooms away from it.
+	imageIndex = std::max(imageIndex, 1);
+	std::cout << "Resuming at zoom " << zoomCount << ", width " << w << std::endl;
+	return true;
+}
+
+void MandelbrotSet::SetCenter(double centerX, double centerY) {
+	centerReal = HighPrecision();
+	centerImag = HighPrecision();
+	MoveCenter(centerX, centerY);
+}
+
+void MandelbrotSet::MoveCenter(double offsetX, double offsetY) {
+	centerReal.AddDouble(offsetX);
+	centerImag.AddDouble(offsetY);
+	x = centerReal.ToDouble();
+	y = centerImag.ToDouble();
+	regionStatsCurrent = false;
+}
+
+/**
+ * Normalized iteration count n + 1 - log_d(log2 |z|) of a point that escaped
+ * at iteration n with |z|^2 = r2 under a formula of degree d: continuous
+ * across the bands of equal n, and n + 1 for a point that stays bounded
+ * (r2 = 4).
+**/
+static inline float NormalizedIteration(int n, double r2, int degree) {
+	double level = std::log2(0.5 * std::log2(r2));
+	return (float)(n + 1 - (degree == 2 ? level : level / std::log2((double) degree)));
+}
+
+void MandelbrotSet::Iterate(const double * cx, const double * cy, const double * cxLo, const double * cyLo, int count, int * escapeIter, RenderStats & stats, const int * pixels, float * smooth) {
+	if(smooth && count > TileSize) {
+		// escapeR2 below holds TileSize points.
+		for(int k = 0; k < count; k += TileSize) {
+			Iterate(cx + k, cy + k, cxLo + k, cyLo + k, std::min(TileSize, count - k), escapeIter + k, stats, pixels ? pixels + k : nullptr, smooth + k);
+		}
+		return;
+	}
+	double escapeR2[TileSize];
+	double * radius2 = smooth ? escapeR2 : nullptr;
+	if(precisionTier == PrecisionPerturbation) {
+		orbit.Run(cx, cy, count, escapeIter, &stats.perturbation, radius2, kernelOptions.distanceThreshold);
+	} else if(precisionTier == PrecisionDoubleDouble) {
+		EscapeKernel::RunDoubleDouble(cx, cxLo, cy, cyLo, count, kernelOptions, escapeIter, radius2);
+	} else if(pixels && history.valid) {
+		// Record where each orbit stopped for the next frame; count <= TileSize.
+		double zx[TileSize], zy[TileSize];
+		bool proven[TileSize];
+		OrbitState state = {zx, zy, proven};
+		EscapeKernel::Run(cx, cy, count, kernelOptions, escapeIter, &stats.kernel, &state, radius2);
+		for(int k = 0; k < count; ++k) {
+			int pixel = pixels[k];
+			history.iterations[pixel] = escapeIter[k];
+			if(escapeIter[k] < kernelOptions.iterations) {
+				history.state[pixel] = FrameHistory::Escaped;
+			} else if(proven[k]) {
+				history.state[pixel] = FrameHistory::Proven;
+			} else if(zx[k] * zx[k] + zy[k] * zy[k] > 4.0) {
+				// Black by the distance estimate, which a smaller pixel may undo.
+				history.state[pixel] = FrameHistory::Unknown;
+			} else {
+				history.state[pixel] = FrameHistory::Bounded;
+				history.zx[pixel] = zx[k];
+				history.zy[pixel] = zy[k];
+			}
+		}
+	} else {
+		EscapeKernel::Run(cx, cy, count, kernelOptions, escapeIter, &stats.kernel, nullptr, radius2);
+	}
+	for(int k = 0; k < count; ++k) {
+		stats.iterations += escapeIter[k];
+	}
+	if(smooth) {
+		for(int k = 0; k < count; ++k) {
+			smooth[k] = NormalizedIteration(escapeIter[k], escapeR2[k], FormulaDegree(kernelOptions.formula));
+		}
+	}
+}
+
+UBYTE MandelbrotSet::ShadeLevel(float smooth) const {
+	return 3 - (smooth >= grayThreshold[0]) - (smooth >= grayThreshold[1]);
+}
+
+void MandelbrotSet::BuildToneMap() {
+	toneMap.assign(ToneMapSize, 255);
+	if(toneSamples.empty()) {
+		grayThreshold[0] = grayThreshold[1] = FLT_MAX;
+		toneScale = 0.0f;
+		return;
+	}
+	// White and the two grays each take a third of the outside samples, the
+	// slowest to escape (nearest the set) the darkest.
+	size_t size = toneSamples.size();
+	grayThreshold[0] = toneSamples[(size + 2) / 3 - 1];
+	grayThreshold[1] = toneSamples[(2 * size + 2) / 3 - 1];
+	toneLow = toneSamples.front();
+	float range = toneSamples.back() - toneLow;
+	toneScale = range > 0.0f ? (ToneMapSize - 1) / range : 0.0f;
+	for(int k = 0; k < ToneMapSize; ++k) {
+		float smooth = toneLow + range * k / (ToneMapSize - 1);
+		double quantile = (double) (std::upper_bound(toneSamples.begin(), toneSamples.end(), smooth) - toneSamples.begin()) / toneSamples.size();
+		toneMap[k] = (UBYTE) std::lround(255.0 * (1.0 - quantile * quantile));
+	}
+}
+
+UBYTE MandelbrotSet::Tone(float smooth) const {
+	float position = (smooth - toneLow) * toneScale;
+	if(!(position > 0.0f)) {
+		return toneMap[0];
+	}
+	if(position >= ToneMapSize - 1) {
+		return toneMap[ToneMapSize - 1];
+	}
+	int k = (int) position;
+	float fraction = position - k;
+	return (UBYTE) (toneMap[k] + (toneMap[k + 1] - toneMap[k]) * fraction + 0.5f);
+}
+
+void MandelbrotSet::ToneRow(int x, int y, int count, UBYTE * tone) const {
+	const int width = columnX.size();
+	const float * smooth = &smoothIter[y * width + x];
+	for(int k = 0; k < count; ++k) {
+		tone[k] = frame.IsBlack(x + k, y) ? 0 : Tone(smooth[k]);
+	}
+	if(Antialiases()) {
+		const UBYTE * mixed = &mixedPlane[y * frame.WidthByte()];
+		for(int k = 0; k < count; ++k) {
+			if(!(mixed[(x + k) / 8] & (0x80 >> ((x + k) % 8)))) {
+				tone[k] = antialiasTone[y * width + x + k];
+			}
+		}
+	}
+}
+
+void MandelbrotSet::AntialiasRow(int y, RenderStats & stats) {
+	const int width = columnX.size();
+	const UBYTE * mixed = &mixedPlane[y * frame.WidthByte()];
+	std::vector < int > pixels;
+	for(int b = 0; b < frame.WidthByte(); ++b) {
+		// Most significant bit first, the pixels in order from the left.
+		for(UBYTE bits = ~mixed[b]; bits;) {
+			int i = __builtin_clz(bits) - 24;
+			pixels.push_back(b * 8 + i);
+			bits &= (UBYTE) ~(0x80 >> i);
+		}
+	}
+	const int grid = antialiasGrid;
+	const int samples = grid * grid;
+	const int batchPixels = TileSize / samples;
+	const double pixelWidth = w / width;
+	const double pixelHeight = h / rowY.size();
+	double cx[TileSize], cy[TileSize], cxLo[TileSize], cyLo[TileSize];
+	int escapeIter[TileSize];
+	float smooth[TileSize];
+	for(size_t begin = 0; begin < pixels.size(); begin += batchPixels) {
+		int count = std::min < int > (batchPixels, pixels.size() - begin);
+		for(int p = 0; p < count; ++p) {
+			int x = pixels[begin + p];
+			Rng jitter = Rng::Stream(y * width + x, 0);
+			for(int k = 0; k < samples; ++k) {
+				// Offset in pixels from the pixel's sample point.
+				double u = (k % grid + 0.5) / grid - 0.5;
+				double v = (k / grid + 0.5) / grid - 0.5;
+				double offsetX, offsetY;
+				if(samplePattern == SampleRotatedGrid) {
+					offsetX = u - v / grid;
+					offsetY = v + u / grid;
+				} else {
+					offsetX = u + (jitter.Uniform() - 0.5) / grid;
+					offsetY = v + (jitter.Uniform() - 0.5) / grid;
+				}
+				int s = p * samples + k;
+				DoubleDouble < double > sampleX = DoubleDouble < double > {columnX[x], columnXLo[x]} + DoubleDouble < double > {offsetX * pixelWidth, 0.0};
+				DoubleDouble < double > sampleY = DoubleDouble < double > {rowY[y], rowYLo[y]} + DoubleDouble < double > {offsetY * pixelHeight, 0.0};
+				cx[s] = sampleX.hi;
+				cxLo[s] = sampleX.lo;
+				cy[s] = sampleY.hi;
+				cyLo[s] = sampleY.lo;
+			}
+		}
+		Iterate(cx, cy, cxLo, cyLo, count * samples, escapeIter, stats, nullptr, smooth);
+		for(int p = 0; p < count; ++p) {
+			int x = pixels[begin + p];
+			int toneSum = 0, levelSum = 0;
+			for(int s = p * samples; s < (p + 1) * samples; ++s) {
+				if(escapeIter[s] < kernelOptions.iterations) {
+					toneSum += Tone(smooth[s]);
+					levelSum += ShadeLevel(smooth[s]);
+				}
+			}
+			antialiasTone[y * width + x] = (UBYTE) ((toneSum + samples / 2) / samples);
+			if(frame.HasGray()) {
+				frame.SetLevel(x, y, (UBYTE) ((levelSum + samples / 2) / samples));
+			}
+		}
+	}
+	stats.pixelsSupersampled += pixels.size();
+}
+
+void MandelbrotSet::DitherReadyBands(std::vector < std::atomic < int > > & bandTiles, int bandHeight, UWORD yResolution) {
+	// A worker that finds another one dithering goes back to its tiles; the
+	// bands it leaves are picked up later, at the latest after the pass.
+	std::unique_lock < std::mutex > lock(ditherMutex, std::try_to_lock);
+	if(!lock.owns_lock()) {
+		return;
+	}
+	const int width = columnX.size();
+	while(nextDitherBand < bandTiles.size() && bandTiles[nextDitherBand].load() == 0) {
+		int y1 = std::min < int > ((nextDitherBand + 1) * bandHeight, yResolution);
+		for(int y = nextDitherBand * bandHeight; y < y1; ++y) {
+			ToneRow(0, y, width, ditherTone.data());
+			diffusion.Row(ditherTone.data(), ditherBlack.data());
+			frame.StoreDitheredRow(0, y, ditherBlack.data(), width);
+		}
+		nextDitherBand++;
+	}
+}
+
+void MandelbrotSet::SeedFromHistory(UWORD xResolution, UWORD yResolution) {
+	std::swap(history, previousHistory);
+	seedIter.assign(xResolution * yResolution, -1);
+	std::swap(smoothIter, previousSmoothIter);
+	if(KeepsSmoothField()) {
+		smoothIter.assign(xResolution * yResolution, 0.0f);
+	} else {
+		smoothIter.clear();
+	}
+	history.valid = frameReuse && precisionTier == PrecisionDouble;
+	if(!history.valid) {
+		return;
+	}
+	history.Reset(xResolution, yResolution);
+	history.centerReal = centerReal;
+	history.centerImag = centerImag;
+	history.w = w;
+	history.h = h;
+	const FrameHistory & previous = previousHistory;
+	if(!previous.valid || previous.width != xResolution || previous.height != yResolution || xResolution % 2 || yResolution % 2) {
+		return;
+	}
+	if(w * 2.0 != previous.w || h * 2.0 != previous.h) {
+		return;
+	}
+	// Smooth counts are carried over as well.
+	bool keepSmooth = KeepsSmoothField();
+	if(keepSmooth && previousSmoothIter.size() != smoothIter.size()) {
+		return;
+	}
+	// Only a zoom onto a quadrant makes the old sample points reappear.
+	double offsetX = (centerReal - previous.centerReal).ToDouble();
+	double offsetY = (centerImag - previous.centerImag).ToDouble();
+	if(std::fabs(offsetX) != previous.w / 4.0 || std::fabs(offsetY) != previous.h / 4.0) {
+		return;
+	}
+	int firstColumn = offsetX > 0.0 ? xResolution / 2 : 0;
+	int firstRow = offsetY > 0.0 ? yResolution / 2 : 0;
+	const int iterations = kernelOptions.iterations;
+	std::vector < int > resume;
+	unsigned long long reused = 0;
+	for(int i = 0; i < yResolution; i += 2) {
+		for(int j = 0; j < xResolution; j += 2) {
+			int pixel = i * xResolution + j;
+			int old = (firstRow + i / 2) * xResolution + firstColumn + j / 2;
+			UBYTE state = previous.state[old];
+			int done = previous.iterations[old];
+			if(state == FrameHistory::Unknown) {
+				continue;
+			}
+			history.state[pixel] = state;
+			history.iterations[pixel] = done;
+			history.zx[pixel] = previous.zx[old];
+			history.zy[pixel] = previous.zy[old];
+			if(state == FrameHistory::Bounded && done < iterations) {
+				// A resumed orbit has no derivative for the distance estimate;
+				// with it, the pixel is iterated afresh.
+				if(kernelOptions.distanceThreshold == 0.0) {
+					resume.push_back(pixel);
+				}
+				continue;
+			}
+			seedIter[pixel] = state == FrameHistory::Escaped && done < iterations ? done : iterations;
+			if(keepSmooth) {
+				smoothIter[pixel] = previousSmoothIter[old];
+			}
+			reused++;
+		}
+	}
+	frameStats.pixelsReused += reused;
+	// Orbits that were still bounded at a lower limit carry on from their
+	// stored z, in chunks that share the number of iterations already done.
+	std::sort(resume.begin(), resume.end(), [ & ](int a, int b) {
+		return history.iterations[a] < history.iterations[b];
+	});
+	const int chunkSize = 256;
+	std::vector < std::pair < int, int >> chunks;
+	for(size_t begin = 0; begin < resume.size();) {
+		size_t end = begin + 1;
+		while(end < resume.size() && end - begin < chunkSize && history.iterations[resume[end]] == history.iterations[resume[begin]]) {
+			end++;
+		}
+		chunks.emplace_back(begin, end);
+		begin = end;
+	}
+	if(chunks.empty()) {
+		return;
+	}
+	scheduler.Run(chunks.size(), [ & ](int chunk, unsigned) {
+		int begin = chunks[chunk].first;
+		int count = chunks[chunk].second - begin;
+		double cx[chunkSize], cy[chunkSize], zx[chunkSize], zy[chunkSize], escapeR2[chunkSize];
+		bool proven[chunkSize];
+		int escapeIter[chunkSize];
+		for(int k = 0; k < count; ++k) {
+			int pixel = resume[begin + k];
+			cx[k] = columnX[pixel % xResolution];
+			cy[k] = rowY[pixel / xResolution];
+			zx[k] = history.zx[pixel];
+			zy[k] = history.zy[pixel];
+		}
+		OrbitState state = {zx, zy, proven};
+		EscapeKernel::Continue(cx, cy, count, history.iterations[resume[begin]], kernelOptions, escapeIter, state, keepSmooth ? escapeR2 : nullptr);
+		for(int k = 0; k < count; ++k) {
+			int pixel = resume[begin + k];
+			seedIter[pixel] = escapeIter[k];
+			if(keepSmooth) {
+				smoothIter[pixel] = NormalizedIteration(escapeIter[k], escapeR2[k], FormulaDegree(kernelOptions.formula));
+			}
+			history.iterations[pixel] = escapeIter[k];
+			history.zx[pixel] = zx[k];
+			history.zy[pixel] = zy[k];
+			if(escapeIter[k] < iterations) {
+				history.state[pixel] = FrameHistory::Escaped;
+			} else if(proven[k]) {
+				history.state[pixel] = FrameHistory::Proven;
+			}
+		}
+	});
+	frameStats.pixelsReused += resume.size();
+	frameStats.pixelsResumed += resume.size();
+}
+void MandelbrotSet::EvaluateLine(UBYTE * classes, UBYTE * levels, int tileWidth, const Tile & tile, int ax, int ay, int bx, int by, RenderStats & stats) {
+	double lineX[TileSize], lineY[TileSize], lineXLo[TileSize], lineYLo[TileSize];
+	float smooth[TileSize];
+	int escapeIter[TileSize], index[TileSize], pixels[TileSize];
+	int count = 0;
+	int dx = ax == bx ? 0 : 1;
+	int dy = ay == by ? 0 : 1;
+	for(int px = ax, py = ay; px <= bx && py <= by; px += dx, py += dy) {
+		int k = py * tileWidth + px;
+		if(classes[k] == PixelUnknown) {
+			lineX[count] = columnX[tile.x0 + px];
+			lineY[count] = rowY[tile.y0 + py];
+			lineXLo[count] = columnXLo[tile.x0 + px];
+			lineYLo[count] = rowYLo[tile.y0 + py];
+			pixels[count] = (tile.y0 + py) * (int) columnX.size() + tile.x0 + px;
+			index[count++] = k;
+		}
+		if(dx == 0 && dy == 0) {
+			break;
+		}
+	}
+	if(count == 0) {
+		return;
+	}
+	Iterate(lineX, lineY, lineXLo, lineYLo, count, escapeIter, stats, pixels, levels ? smooth : nullptr);
+	stats.pixelsIterated += count;
+	for(int p = 0; p < count; ++p) {
+		classes[index[p]] = escapeIter[p] >= kernelOptions.iterations ? PixelInside : PixelOutside;
+	}
+	if(levels) {
+		for(int p = 0; p < count; ++p) {
+			smoothIter[pixels[p]] = smooth[p];
+			levels[index[p]] = classes[index[p]] == PixelInside ? 0 : ShadeLevel(smooth[p]);
+		}
+	}
+}
+
+void MandelbrotSet::Subdivide(UBYTE * classes, UBYTE * levels, int tileWidth, const Tile & tile, int x0, int y0, int x1, int y1, RenderStats & stats) {
+	EvaluateLine(classes, levels, tileWidth, tile, x0, y0, x1, y0, stats);
+	EvaluateLine(classes, levels, tileWidth, tile, x0, y1, x1, y1, stats);
+	EvaluateLine(classes, levels, tileWidth, tile, x0, y0, x0, y1, stats);
+	EvaluateLine(classes, levels, tileWidth, tile, x1, y0, x1, y1, stats);
+	if(x1 - x0 < 2 || y1 - y0 < 2) {
+		return;
+	}
+	// With gray levels the border must agree on the level as well.
+	UBYTE * decided = levels ? levels : classes;
+	UBYTE first = decided[y0 * tileWidth + x0];
+	bool uniform = true;
+	for(int px = x0; px <= x1 && uniform; ++px) {
+		uniform = decided[y0 * tileWidth + px] == first && decided[y1 * tileWidth + px] == first;
+	}
+	for(int py = y0; py <= y1 && uniform; ++py) {
+		uniform = decided[py * tileWidth + x0] == first && decided[py * tileWidth + x1] == first;
+	}
+	if(uniform) {
+		UBYTE firstClass = classes[y0 * tileWidth + x0];
+		for(int py = y0 + 1; py < y1; ++py) {
+			memset(&classes[py * tileWidth + x0 + 1], firstClass, x1 - x0 - 1);
+		}
+		if(levels) {
+			// Filled pixels take the level, and a smooth count blended from
+			// the corners.
+			const int frameWidth = columnX.size();
+			float * smooth = &smoothIter[tile.y0 * frameWidth + tile.x0];
+			float s00 = smooth[y0 * frameWidth + x0], s01 = smooth[y0 * frameWidth + x1];
+			float s10 = smooth[y1 * frameWidth + x0], s11 = smooth[y1 * frameWidth + x1];
+			for(int py = y0 + 1; py < y1; ++py) {
+				memset(&levels[py * tileWidth + x0 + 1], first, x1 - x0 - 1);
+				float fy = (float)(py - y0) / (y1 - y0);
+				float left = s00 + (s10 - s00) * fy;
+				float right = s01 + (s11 - s01) * fy;
+				for(int px = x0 + 1; px < x1; ++px) {
+					smooth[py * frameWidth + px] = left + (right - left) * (float)(px - x0) / (x1 - x0);
+				}
+			}
 		}
+		stats.pixelsFilled += (x1 - x0 - 1) * (y1 - y0 - 1);
+		return;
+	}
+	if((x1 - x0) * (y1 - y0) <= MinSubdivisionArea) {
+		for(int py = y0 + 1; py < y1; ++py) {
+			EvaluateLine(classes, levels, tileWidth, tile, x0 + 1, py, x1 - 1, py, stats);
+		}
+		return;
+	}
+	// Split across the longer side; both halves share the dividing line.
+	if(x1 - x0 >= y1 - y0) {
+		int mid = (x0 + x1) / 2;
+		Subdivide(classes, levels, tileWidth, tile, x0, y0, mid, y1, stats);
+		Subdivide(classes, levels, tileWidth, tile, mid, y0, x1, y1, stats);
+	} else {
+		int mid = (y0 + y1) / 2;
+		Subdivide(classes, levels, tileWidth, tile, x0, y0, x1, mid, stats);
+		Subdivide(classes, levels, tileWidth, tile, x0, mid, x1, y1, stats);
+	}
+}
+
+void MandelbrotSet::RenderTile(const Tile & tile, RenderStats & stats) {
+	UBYTE classes[TileSize * TileSize];
+	UBYTE grayLevels[TileSize * TileSize];
+	// Without a gray plane the levels still steer subdivision for dithering.
+	UBYTE * levels = KeepsSmoothField() ? grayLevels : nullptr;
+	int width = tile.x1 - tile.x0;
+	int height = tile.y1 - tile.y0;
+	// Pixels carried over from the previous frame start out decided.
+	const int frameWidth = columnX.size();
+	for(int py = 0; py < height; ++py) {
+		const int * seeds = &seedIter[(tile.y0 + py) * frameWidth + tile.x0];
+		for(int px = 0; px < width; ++px) {
+			classes[py * width + px] = seeds[px] < 0 ? PixelUnknown : seeds[px] >= kernelOptions.iterations ? PixelInside : PixelOutside;
+		}
+		if(levels) {
+			const float * smooth = &smoothIter[(tile.y0 + py) * frameWidth + tile.x0];
+			for(int px = 0; px < width; ++px) {
+				UBYTE pixelClass = classes[py * width + px];
+				levels[py * width + px] = pixelClass == PixelOutside ? ShadeLevel(smooth[px]) : 0;
+			}
+		}
+	}
+	if(renderMode == RenderSubdivision) {
+		Subdivide(classes, levels, width, tile, 0, 0, width - 1, height - 1, stats);
+	} else {
+		for(int py = 0; py < height; ++py) {
+			EvaluateLine(classes, levels, width, tile, 0, py, width - 1, py, stats);
+		}
+	}
+	// All planes are packed from the same classes in the same pass; ordered
+	// dithering needs nothing outside the tile either, unless antialiasing
+	// still has to change the tones.
+	bool ordered = IsOrderedDither(ditherMode) && !Antialiases();
+	for(int py = 0; py < height; ++py) {
+		stats.blackPixels += frame.StoreRow(tile.x0, tile.y0 + py, &classes[py * width], width);
+		if(frame.HasGray()) {
+			frame.StoreGrayRow(tile.x0, tile.y0 + py, &levels[py * width], width);
+		}
+		if(ordered) {
+			UBYTE tone[TileSize], black[TileSize];
+			ToneRow(tile.x0, tile.y0 + py, width, tone);
+			OrderedDither::Row(ditherMode, tile.x0, tile.y0 + py, tone, black, width);
+			frame.StoreDitheredRow(tile.x0, tile.y0 + py, black, width);
+		}
+	}
+}
+
+void MandelbrotSet::PreparePass(UWORD xResolution, UWORD yResolution) {
+	columnX.resize(xResolution);
+	rowY.resize(yResolution);
+	columnXLo.assign(xResolution, 0.0);
+	rowYLo.assign(yResolution, 0.0);
+	double pixelSize = this->w / xResolution;
+	double magnitude = std::max(1.0, std::max(std::fabs(this->x), std::fabs(this->y)));
+	PrecisionTier tier = PrecisionDouble;
+	// The deeper tiers iterate the Mandelbrot set only.
+	bool deepTiers = kernelOptions.formula == FormulaMandelbrot;
+	if(deepTiers && pixelSize < DoubleDoubleMinPixel * magnitude) {
+		tier = PrecisionPerturbation;
+	} else if(deepTiers && pixelSize < DoubleMinPixel * magnitude) {
+		tier = PrecisionDoubleDouble;
+	}
+	renderedResX = xResolution;
+	renderedResY = yResolution;
+	if(tier != precisionTier) {
+		static const char * const tierNames[] = {"double", "double-double", "perturbation"};
+		std::cout << "Switching to " << tierNames[tier] << " precision at width " << this->w << std::endl;
+		precisionTier = tier;
+	}
+	// Perturbation takes offsets from the centre; double takes coordinates.
+	double originX = tier == PrecisionPerturbation ? 0.0 : this->x;
+	double originY = tier == PrecisionPerturbation ? 0.0 : this->y;
+	for(int j = 0; j < xResolution; ++j) {
+		columnX[j] = originX - this->w / 2.0 + (double) j / (double) xResolution * this->w;
+	}
+	for(int i = 0; i < yResolution; ++i) {
+		rowY[i] = originY - this->h / 2.0 + (double) i / (double) yResolution * this->h;
+	}
+	if(tier == PrecisionDoubleDouble) {
+		for(int j = 0; j < xResolution; ++j) {
+			HighPrecision coordinate = centerReal;
+			coordinate.AddDouble(- this->w / 2.0 + (double) j / (double) xResolution * this->w);
+			coordinate.ToDoubleDouble(columnX[j], columnXLo[j]);
+		}
+		for(int i = 0; i < yResolution; ++i) {
+			HighPrecision coordinate = centerImag;
+			coordinate.AddDouble(- this->h / 2.0 + (double) i / (double) yResolution * this->h);
+			coordinate.ToDoubleDouble(rowY[i], rowYLo[i]);
+		}
+	}
+	if(tier == PrecisionPerturbation) {
+		orbit.Compute(centerReal, centerImag, pixelSize, std::hypot(this->w, this->h) / 2.0, kernelOptions.iterations);
+	}
+}
+
+bool MandelbrotSet::ProbeView(UWORD xResolution, UWORD yResolution, double minBlackFraction, double maxBlackFraction) {
+	// One sample at the centre of every ProbeStride x ProbeStride block.
+	int columns = xResolution / ProbeStride;
+	int rows = yResolution / ProbeStride;
+	if(columns == 0 || rows == 0) {
+		return true;
+	}
+	std::vector < double > sampleX(columns), sampleXLo(columns);
+	for(int j = 0; j < columns; ++j) {
+		sampleX[j] = columnX[j * ProbeStride + ProbeStride / 2];
+		sampleXLo[j] = columnXLo[j * ProbeStride + ProbeStride / 2];
+	}
+	std::vector < RenderStats > threadStats(scheduler.ThreadCount());
+	std::vector < UBYTE > sampleBlack(columns * rows);
+	bool keepSmooth = KeepsSmoothField();
+	std::vector < float > sampleSmooth(keepSmooth ? columns * rows : 0);
+	scheduler.Run(rows, [ & ](int row, unsigned threadIndex) {
+		std::vector < double > lineY(columns, rowY[row * ProbeStride + ProbeStride / 2]);
+		std::vector < double > lineYLo(columns, rowYLo[row * ProbeStride + ProbeStride / 2]);
+		std::vector < int > escapeIter(columns);
+		RenderStats & stats = threadStats[threadIndex];
+		Iterate(sampleX.data(), lineY.data(), sampleXLo.data(), lineYLo.data(), columns, escapeIter.data(), stats, nullptr, keepSmooth ? &sampleSmooth[row * columns] : nullptr);
+		stats.pixelsIterated += columns;
+		for(int j = 0; j < columns; ++j) {
+			sampleBlack[row * columns + j] = escapeIter[j] >= kernelOptions.iterations;
+			stats.blackPixels += sampleBlack[row * columns + j];
+		}
+	});
+	int samples = columns * rows;
+	int black = 0;
+	for(auto & stats: threadStats) {
+		black += stats.blackPixels;
+		stats.blackPixels = 0;
+		frameStats.Add(stats);
+	}
+	// The samples are a coarse frame of this view for the zoom search, until
+	// a full render replaces them.
+	int widthByte = (columns + 7) / 8;
+	probeImage.assign(widthByte * rows, 0xFF);
+	for(int i = 0; i < rows; ++i) {
+		for(int j = 0; j < columns; ++j) {
+			if(sampleBlack[i * columns + j]) {
+				probeImage[i * widthByte + j / 8] &= ~(0x80 >> (j % 8));
+			}
+		}
+	}
+	regionStats.Build(probeImage.data(), widthByte, columns, rows);
+	regionStatsCurrent = true;
+	if(keepSmooth) {
+		// The outside samples fix the gray scale and the dither tone before
+		// the full pass, so that each tile or band can be drawn as soon as
+		// it is rendered.
+		toneSamples.clear();
+		for(int k = 0; k < samples; ++k) {
+			if(!sampleBlack[k]) {
+				toneSamples.push_back(sampleSmooth[k]);
+			}
+		}
+		std::sort(toneSamples.begin(), toneSamples.end());
+		BuildToneMap();
+	}
+	double fraction = (double) black / samples;
+	// Normal-approximation bound on the sampled fraction, widened by a fixed
+	// slack because a regular grid can alias thin filaments.
+	double margin = ProbeConfidence * std::sqrt(std::max(fraction * (1.0 - fraction), 0.25 / samples) / samples) + ProbeSlack;
+	if(fraction + margin < minBlackFraction || fraction - margin > maxBlackFraction) {
+		std::cout << "Probe rejected view: black fraction " << fraction << " +/- " << margin << std::endl;
+		return false;
 	}
 	return true;
 }
 
+int MandelbrotSet::RenderPass(UWORD xResolution, UWORD yResolution) {
+	// Subdivision pays off on larger tiles: a 64x64 border is 6% of the tile.
+	int tileHeight = renderMode == RenderSubdivision ? TileSize : 16;
+	std::vector < Tile > tiles = MakeTiles(xResolution, yResolution, TileSize, tileHeight);
+	std::vector < RenderStats > threadStats(scheduler.ThreadCount());
+	frame.Bind(xResolution, yResolution, shadeMode == ShadeGray4, ditherMode != DitherNone);
+	SeedFromHistory(xResolution, yResolution);
+	// Tiles left to render per band of tile rows; for error diffusion, the
+	// worker that finishes a band dithers every band that is complete from
+	// the top down.
+	bool diffused = ditherMode != DitherNone && !IsOrderedDither(ditherMode);
+	// With antialiasing, dithering waits for the supersampled tones.
+	bool antialias = Antialiases();
+	int tileColumns = (xResolution + TileSize - 1) / TileSize;
+	std::vector < std::atomic < int > > bandTiles(diffused ? (tiles.size() + tileColumns - 1) / tileColumns : 0);
+	if(diffused) {
+		for(auto & band: bandTiles) {
+			band.store(tileColumns);
+		}
+		diffusion.Reset(xResolution, ditherMode);
+		ditherTone.resize(xResolution);
+		ditherBlack.resize(xResolution);
+		nextDitherBand = 0;
+	}
+	scheduler.Run(tiles.size(), [ & ](int tileIndex, unsigned threadIndex) {
+		RenderTile(tiles[tileIndex], threadStats[threadIndex]);
+		if(diffused && --bandTiles[tileIndex / tileColumns] == 0 && !antialias) {
+			DitherReadyBands(bandTiles, tileHeight, yResolution);
+		}
+	});
+	if(antialias) {
+		mixedPlane.resize(frame.WidthByte() * yResolution);
+		BitplaneStats::MarkMixed(frame.Row(0), frame.WidthByte(), xResolution, yResolution, mixedPlane.data());
+		antialiasTone.resize(xResolution * yResolution);
+		bool ordered = IsOrderedDither(ditherMode);
+		scheduler.Run(yResolution, [ & ](int y, unsigned threadIndex) {
+			AntialiasRow(y, threadStats[threadIndex]);
+			if(ordered) {
+				std::vector < UBYTE > tone(xResolution), black(xResolution);
+				ToneRow(0, y, xResolution, tone.data());
+				OrderedDither::Row(ditherMode, 0, y, tone.data(), black.data(), xResolution);
+				frame.StoreDitheredRow(0, y, black.data(), xResolution);
+			}
+		});
+	}
+	// The bands left by workers that found the dithering busy, or all of them
+	// after antialiasing.
+	if(diffused) {
+		DitherReadyBands(bandTiles, tileHeight, yResolution);
+	}
+	frame.Publish();
+	regionStats.Build(frame.Row(0), frame.WidthByte(), xResolution, yResolution);
+	regionStatsCurrent = true;
+	int blackPixelCount = 0;
+	for(const auto & stats: threadStats) {
+		blackPixelCount += stats.blackPixels;
+		frameStats.Add(stats);
+	}
+	return blackPixelCount;
+}
+
 void MandelbrotSet::Render(UWORD xResolution, UWORD yResolution) {
-	const int numThreads = 4;
-	int chunkSize = yResolution / numThreads;
-	std::vector < std::thread > threads;
-	std::mutex mutex;
-	static int imageIndex = 0;
 	bool validImage = false;
 	int blackPixelCount = 0;
 	int totalPixelCount = xResolution * yResolution;
 	int retryCount = 0;
+	int probeRejections = 0;
+	retries = 0;
 	const int maxRetries = 20;
-	const int minBlackPixelCount = totalPixelCount * 0.2;
-	const int maxBlackPixelCount = totalPixelCount * 0.9;
+	const int minBlackPixelCount = totalPixelCount * MinBlackFraction;
+	const int maxBlackPixelCount = totalPixelCount * MaxBlackFraction;
 
 	double aspectRatio = (double) xResolution / (double) yResolution;
+	scheduler.ResetStats();
+	frameStats = RenderStats();
 
 	int iter = (50 + std::max(0.0, -log10(w)) * 100); 
-	iter += rand() % 50; 
-	auto renderChunk = [ & ](int startY, int endY, int & localBlackPixelCount) {
-		for(int i = startY; i < endY; ++i) {
-			for(int j = 0; j < xResolution; ++j) {
-				double p_x = this - > x - this - > w / 2.0 + (double) j / (double) xResolution * this - > w;
-				double p_y = this - > y - this - > h / 2.0 + (double) i / (double) yResolution * this - > h;
-				bool isMandelPoint = IsMandelPoint(p_x, p_y, iter);
-				if(isMandelPoint) {
-					localBlackPixelCount++;
-				}
-				Paint_SetPixel(j, i, isMandelPoint ? BLACK : WHITE);
-			}
-		}
+	iter += rng.Below(50); 
+	kernelOptions.iterations = iter;
+	kernelOptions.interiorTests = interiorTests;
+	// A hundredth of a pixel: well below anything that changes a pixel's class.
+	const double periodToleranceFactor = 0.01;
+	auto setTolerances = [ & ]() {
+		kernelOptions.periodTolerance = periodicityCheck ? periodToleranceFactor * w / xResolution : 0.0;
+		kernelOptions.distanceThreshold = distancePixels * w / xResolution;
 	};
+	// False while the view is a search candidate that is already in place.
+	bool zoomPending = true;
 	while(!validImage) {
 		blackPixelCount = 0;
 
@@ -77,104 +842,252 @@ void MandelbrotSet::Render(UWORD xResolution, UWORD yResolution) {
 			if(w / h != aspectRatio) {
 				h = w / aspectRatio;
 			}
-		} else {
+		} else if(zoomPending) {
+			if(!regionStatsCurrent) {
+				// A view restored from the state file or reached by a random
+				// jump: the search needs at least the probe's coarse frame.
+				setTolerances();
+				PreparePass(xResolution, yResolution);
+				ProbeView(xResolution, yResolution, 0.0, 1.0);
+			}
 			ZoomOnInterestingArea();
 			h = w / aspectRatio; 
 		}
 		imageIndex++;
-		std::vector < int > localBlackCounts(numThreads, 0);
-		for(int t = 0; t < numThreads; ++t) {
-			int startY = t * chunkSize;
-			int endY = (t == numThreads - 1) ? yResolution : (t + 1) * chunkSize;
-			threads.emplace_back(renderChunk, startY, endY, std::ref(localBlackCounts[t]));
-		}
-		for(auto & thread: threads) {
-			if(thread.joinable()) {
-				thread.join();
-			}
-		}
-		for(int count: localBlackCounts) {
-			blackPixelCount += count;
+		zoomPending = true;
+		setTolerances();
+		PreparePass(xResolution, yResolution);
+		// A view the sparse probe already rules out is not worth a full render.
+		bool plausible = ProbeView(xResolution, yResolution, viewFixed ? 0.0 : MinBlackFraction, viewFixed ? 1.0 : MaxBlackFraction);
+		if(plausible) {
+			blackPixelCount = RenderPass(xResolution, yResolution);
+		} else {
+			probeRejections++;
 		}
-		if(blackPixelCount >= minBlackPixelCount && blackPixelCount <= maxBlackPixelCount) {
+		if(plausible && (viewFixed || (blackPixelCount >= minBlackPixelCount && blackPixelCount <= maxBlackPixelCount))) {
 			validImage = true;
-		} else {
+			zoomCount++;
+		}
+		if(!validImage) {
 			retryCount++;
+			retries++;
 			if(retryCount >= maxRetries) {
 				std::cout << "Max retries reached. Exploring a new random region." << std::endl;
-				x = (rand() % 10000 - 5000) / 1000.0;
-				y = (rand() % 8000 - 4000) / 1000.0;
+				double newX = (rng.Below(10000) - 5000) / 1000.0;
+				double newY = (rng.Below(8000) - 4000) / 1000.0;
+				SetCenter(newX, newY);
 				w = std::min(1.5, w); 
 				h = w / aspectRatio;
 				retryCount = 0;
+			} else if(NextZoomCandidate()) {
+				h = w / aspectRatio;
+				zoomPending = false;
+				std::cout << "Trying zoom candidate " << zoomCandidateIndex + 1 << " of " << zoomCandidates.size() << std::endl;
+			} else if(regionStatsCurrent && ZoomIntoCandidates()) {
+				// Some part of the rejected view may still be in the band.
+				h = w / aspectRatio;
+				zoomPending = false;
+				std::cout << "Zooming into the rejected view" << std::endl;
 			} else {
-
-				x += ((rand() % 1000) - 500) / 100.0; 
-				y += ((rand() % 1000) - 500) / 100.0;
-				double zoomFactor = 1.0 + ((rand() % 200) / 100.0); 
-				w *= zoomFactor;
-				h = w / aspectRatio; 
-				if(w > 1.0) w = 1.0;
-				if(w < 0.05) w = 0.05;
-				std::cout << "Exploring new region: retry " << retryCount << " with zoom factor " << zoomFactor << std::endl;
+				// Nothing inside this view passed. Step back out and search the
+				// wider view rather than jumping away and losing the zoom path.
+				MoveCenter(0.0, 0.0);
+				w *= 4.0;
+				h = w / aspectRatio;
+				std::cout << "Widening the view: retry " << retryCount << std::endl;
 			}
 		}
-		threads.clear();
+	}
+	viewFixed = false;
+	blackRatio = (float) blackPixelCount / totalPixelCount;
+	std::cout << scheduler.LoadBalanceReport() << std::endl;
+	if(probeRejections > 0) {
+		std::cout << "Probe rejected " << probeRejections << " candidate views without a full render" << std::endl;
+	}
+	std::cout << "Interior pixels skipped: cardioid " << frameStats.kernel.cardioidSkipped << ", period-2 bulb " << frameStats.kernel.period2Skipped << ", higher bulbs " << frameStats.kernel.higherBulbSkipped << std::endl;
+	if(renderMode == RenderSubdivision) {
+		std::cout << "Boundary subdivision: " << frameStats.pixelsIterated << " pixels iterated, " << frameStats.pixelsFilled << " filled" << std::endl;
+	}
+	if(frameStats.pixelsReused > 0) {
+		std::cout << "Reused " << frameStats.pixelsReused << " pixels of the previous frame, " << frameStats.pixelsResumed << " of them resumed to the new iteration limit" << std::endl;
+	}
+	if(frameStats.pixelsSupersampled > 0) {
+		std::cout << "Antialiasing: " << frameStats.pixelsSupersampled << " boundary pixels supersampled at " << antialiasGrid * antialiasGrid << "x" << std::endl;
+	}
+	if(precisionTier == PrecisionPerturbation) {
+		std::cout << "Perturbation: reference orbit " << orbit.ReferenceLength() << " iterations, " << orbit.SkippedIterations() << " skipped by series approximation, " << frameStats.perturbation.rebases << " rebases" << std::endl;
 	}
 }
-double MandelbrotSet::GetImprovedUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv) {
-	unsigned long long numWhite = 0;
-	unsigned long long numBlack = 0;
-	double totalPixels = fW * fH;
-	for(int wStart = 0; wStart < fW; ++wStart) {
-		for(int hStart = 0; hStart < fH; ++hStart) {
-			int xPointIndex = xOffset + wStart;
-			int yPointIndex = yOffset + hStart;
-			if(Paint_GetPixel(xPointIndex, yPointIndex) == WHITE) numWhite++;
-			else numBlack++;
+void MandelbrotSet::ProbeCandidate(const ZoomCandidate & candidate, int columns, int rows, int limit, UBYTE * black, RenderStats & stats) {
+	// The grid ProbeView would sample once the candidate is the view, placed
+	// relative to the current centre so every tier can evaluate it.
+	double width = this->w * candidate.scale;
+	double height = this->h * candidate.scale;
+	std::vector < double > sampleX(columns), sampleXLo(columns, 0.0), sampleY(rows), sampleYLo(rows, 0.0);
+	for(int j = 0; j < columns; ++j) {
+		double offset = candidate.offsetX - width / 2.0 + (double)(j * ProbeStride + ProbeStride / 2) / (double) renderedResX * width;
+		if(precisionTier == PrecisionDoubleDouble) {
+			HighPrecision coordinate = centerReal;
+			coordinate.AddDouble(offset);
+			coordinate.ToDoubleDouble(sampleX[j], sampleXLo[j]);
+		} else {
+			sampleX[j] = precisionTier == PrecisionPerturbation ? offset : this->x + offset;
 		}
 	}
-
-	return std::max((double) numWhite / totalPixels, (double) numBlack / totalPixels);
+	for(int i = 0; i < rows; ++i) {
+		double offset = candidate.offsetY - height / 2.0 + (double)(i * ProbeStride + ProbeStride / 2) / (double) renderedResY * height;
+		if(precisionTier == PrecisionDoubleDouble) {
+			HighPrecision coordinate = centerImag;
+			coordinate.AddDouble(offset);
+			coordinate.ToDoubleDouble(sampleY[i], sampleYLo[i]);
+		} else {
+			sampleY[i] = precisionTier == PrecisionPerturbation ? offset : this->y + offset;
+		}
+	}
+	// The distance threshold stays that of the current view's pixel, a few
+	// candidate pixels wide, so candidates come out a little darker; the
+	// probe of the view once zoomed on has the last word.
+	std::vector < double > lineY(columns), lineYLo(columns);
+	std::vector < int > escapeIter(columns);
+	for(int i = 0; i < rows; ++i) {
+		std::fill(lineY.begin(), lineY.end(), sampleY[i]);
+		std::fill(lineYLo.begin(), lineYLo.end(), sampleYLo[i]);
+		Iterate(sampleX.data(), lineY.data(), sampleXLo.data(), lineYLo.data(), columns, escapeIter.data(), stats);
+		for(int j = 0; j < columns; ++j) {
+			black[i * columns + j] = escapeIter[j] >= limit;
+		}
+	}
+	stats.pixelsIterated += columns * rows;
 }
 
-void MandelbrotSet::ZoomOnInterestingArea() {
-	std::vector < std::tuple < double, double, double >> choices;
+void MandelbrotSet::SearchZoomTargets() {
+	// The statistics cover the view either at full resolution (a rendered
+	// frame) or at probe resolution (a view the probe rejected).
+	int width = regionStats.Width();
+	int height = regionStats.Height();
+	edgePlane.resize(regionStats.WidthByte() * height);
+	BitplaneStats::MarkEdges(regionStats.Image(), regionStats.WidthByte(), width, height, edgePlane.data());
+	edgeStats.Build(edgePlane.data(), regionStats.WidthByte(), width, height);
 
-	auto uniformnessTopLeft = GetImprovedUniformnessOfArea(this - > renderedResX / 2, this - > renderedResY / 2, 0, 0, 2, 2);
-	choices.emplace_back(this - > x - this - > w / 4, this - > y + this - > h / 4, uniformnessTopLeft);
-	auto uniformnessTopRight = GetImprovedUniformnessOfArea(this - > renderedResX / 2, this - > renderedResY / 2, this - > renderedResX / 2, 0, 2, 2);
-	choices.emplace_back(this - > x + this - > w / 4, this - > y + this - > h / 4, uniformnessTopRight);
-	auto uniformnessBottomLeft = GetImprovedUniformnessOfArea(this - > renderedResX / 2, this - > renderedResY / 2, 0, this - > renderedResY / 2, 2, 2);
-	choices.emplace_back(this - > x - this - > w / 4, this - > y - this - > h / 4, uniformnessBottomLeft);
-	auto uniformnessBottomRight = GetImprovedUniformnessOfArea(this - > renderedResX / 2, this - > renderedResY / 2, this - > renderedResX / 2, this - > renderedResY / 2, 2, 2);
-	choices.emplace_back(this - > x + this - > w / 4, this - > y - this - > h / 4, uniformnessBottomRight);
+	// Sub-windows of 1/2, 1/3 and 1/4 of the view, centred on a grid of half
+	// their size, ranked by how much of the last frame's boundary they hold.
+	// Extra iterations only turn black pixels white, so windows already short
+	// of black are not worth a probe.
+	std::vector < ZoomCandidate > candidates;
+	for(int divisions = 2; divisions <= 4; ++divisions) {
+		double scale = 1.0 / divisions;
+		for(int v = 1; v < 2 * divisions; ++v) {
+			for(int u = 1; u < 2 * divisions; ++u) {
+				double centerU = (double) u / (2 * divisions);
+				double centerV = (double) v / (2 * divisions);
+				int x0 = (int) std::lround((centerU - scale / 2.0) * width);
+				int x1 = (int) std::lround((centerU + scale / 2.0) * width);
+				int y0 = (int) std::lround((centerV - scale / 2.0) * height);
+				int y1 = (int) std::lround((centerV + scale / 2.0) * height);
+				double area = (double)(x1 - x0) * (y1 - y0);
+				if(area <= 0 || regionStats.Black(x0, y0, x1, y1) < MinBlackFraction / 2.0 * area) {
+					continue;
+				}
+				// Row 0 is the bottom of the view (smallest imaginary part).
+				candidates.push_back({(centerU - 0.5) * this->w, (centerV - 0.5) * this->h, scale, edgeStats.Black(x0, y0, x1, y1) / area});
+			}
+		}
+	}
+	auto byScore = [](const ZoomCandidate & a, const ZoomCandidate & b) {
+		return a.score > b.score;
+	};
+	std::stable_sort(candidates.begin(), candidates.end(), byScore);
+	if(candidates.size() > (size_t) SearchProbes) {
+		candidates.resize(SearchProbes);
+	}
 
-	w /= 2.0;
-	h /= 2.0;
+	// Probe the survivors at the new scale, one per render thread, and score
+	// them by how often neighbouring samples differ.
+	int columns = renderedResX / ProbeStride;
+	int rows = renderedResY / ProbeStride;
+	if(candidates.empty() || columns < 2 || rows < 2) {
+		zoomCandidates = candidates;
+		return;
+	}
+	int limit = precisionTier == PrecisionPerturbation ? orbit.Iterations() : kernelOptions.iterations;
+	std::vector < RenderStats > threadStats(scheduler.ThreadCount());
+	std::vector < UBYTE > plausible(candidates.size());
+	scheduler.Run(candidates.size(), [ & ](int index, unsigned threadIndex) {
+		std::vector < UBYTE > black(columns * rows);
+		ProbeCandidate(candidates[index], columns, rows, limit, black.data(), threadStats[threadIndex]);
+		int blackCount = 0;
+		int boundary = 0;
+		for(int i = 0; i < rows; ++i) {
+			for(int j = 0; j < columns; ++j) {
+				UBYTE sample = black[i * columns + j];
+				blackCount += sample;
+				boundary += j + 1 < columns && sample != black[i * columns + j + 1];
+				boundary += i + 1 < rows && sample != black[(i + 1) * columns + j];
+			}
+		}
+		double fraction = (double) blackCount / (columns * rows);
+		plausible[index] = fraction >= MinBlackFraction && fraction <= MaxBlackFraction;
+		candidates[index].score = (double) boundary / (2 * columns * rows - columns - rows);
+	});
+	unsigned long long samples = 0;
+	for(const auto & stats: threadStats) {
+		samples += stats.pixelsIterated;
+	}
+	zoomCandidates.clear();
+	for(size_t k = 0; k < candidates.size(); ++k) {
+		if(plausible[k]) {
+			zoomCandidates.push_back(candidates[k]);
+		}
+	}
+	std::stable_sort(zoomCandidates.begin(), zoomCandidates.end(), byScore);
+	std::cout << "Zoom search: " << candidates.size() << " candidates probed with " << samples << " samples, " << zoomCandidates.size() << " plausible";
+	if(!zoomCandidates.empty()) {
+		std::cout << ", best 1/" << std::lround(1.0 / zoomCandidates.front().scale) << " of the view with boundary score " << zoomCandidates.front().score;
+	}
+	std::cout << std::endl;
+}
 
-	choices.erase(std::remove_if(choices.begin(), choices.end(),
-		[](const std::tuple < double, double, double > & region) {
-			return std::get < 2 > (region) >= 0.98; 
-		}), choices.end());
-
-	choices.erase(std::remove_if(choices.begin(), choices.end(),
-		[](const std::tuple < double, double, double > & region) {
-			return std::get < 2 > (region) <= 0.35; 
-		}), choices.end());
-
-	std::random_device rd;
-	std::mt19937 g(rd());
-	if(!choices.empty()) {
-		std::shuffle(choices.begin(), choices.end(), g);
-		auto[newX, newY, _] = choices.front();
-		x = newX;
-		y = newY;
-	} else {
+void MandelbrotSet::ApplyZoomCandidate(const ZoomCandidate & candidate) {
+	centerReal = parentReal;
+	centerImag = parentImag;
+	w = parentW * candidate.scale;
+	h = parentH * candidate.scale;
+	MoveCenter(candidate.offsetX, candidate.offsetY);
+}
 
-		x += ((rand() % 100) - 50) / 1000.0;
-		y += ((rand() % 100) - 50) / 1000.0;
+bool MandelbrotSet::NextZoomCandidate() {
+	if(zoomCandidateIndex + 1 >= zoomCandidates.size()) {
+		return false;
 	}
+	ApplyZoomCandidate(zoomCandidates[++zoomCandidateIndex]);
+	return true;
+}
+
+bool MandelbrotSet::ZoomIntoCandidates() {
+	zoomCandidates.clear();
+	zoomCandidateIndex = 0;
+	SearchZoomTargets();
+	if(zoomCandidates.empty()) {
+		return false;
+	}
+	parentReal = centerReal;
+	parentImag = centerImag;
+	parentW = w;
+	parentH = h;
+	ApplyZoomCandidate(zoomCandidates.front());
+	return true;
+}
+
+void MandelbrotSet::ZoomOnInterestingArea() {
+	if(regionStatsCurrent && ZoomIntoCandidates()) {
+		return;
+	}
+	zoomCandidates.clear();
+	w /= 2.0;
+	h /= 2.0;
+	double offsetX = (rng.Below(100) - 50) / 1000.0;
+	double offsetY = (rng.Below(100) - 50) / 1000.0;
+	MoveCenter(offsetX, offsetY);
 }
 
 void explore_branch_like_areas(double & zoom_factor, double & pan_x, double & pan_y) {
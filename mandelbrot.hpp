@@ -1,4 +1,143 @@
 #include "DEV_Config.h"
+#include "tile_scheduler.hpp"
+#include "escape_kernel.hpp"
+#include "high_precision.hpp"
+#include "perturbation.hpp"
+#include "packed_frame.hpp"
+#include "bitplane_stats.hpp"
+#include "frame_ring.hpp"
+#include "rng.hpp"
+#include "error_diffusion.hpp"
+#include "ordered_dither.hpp"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * How a pass decides the class of each pixel:
+ *   RenderPerPixel     every pixel goes through the escape kernel
+ *   RenderSubdivision  Mariani-Silver: only rectangle borders are iterated and
+ *                      rectangles with a uniform border are filled
+**/
+enum RenderMode {
+	RenderPerPixel,
+	RenderSubdivision,
+};
+
+/**
+ * What the frame holds per pixel:
+ *   ShadeBlackWhite  1bpp, black inside the set
+ *   ShadeGray4       a 2bpp plane as well, for 4-gray panels: black inside,
+ *                    white and two grays outside by normalized iteration
+ *                    count, so the boundary is shaded rather than cut
+**/
+enum ShadeMode {
+	ShadeBlackWhite,
+	ShadeGray4,
+};
+
+/**
+ * Where the subsamples of an antialiased pixel go, on an n x n pattern:
+ *   SampleRotatedGrid  the grid turned by atan(1/n), so that no two samples
+ *                      share a row or a column (at 4x, RGSS)
+ *   SampleJittered     one random point in each cell of the grid, fixed per
+ *                      pixel so that a frame renders the same every time
+**/
+enum SamplePattern {
+	SampleRotatedGrid,
+	SampleJittered,
+};
+
+/**
+ * Arithmetic a pass iterates with, picked from the pixel size:
+ *   PrecisionDouble        plain doubles through EscapeKernel
+ *   PrecisionDoubleDouble  ~106-bit double-double through EscapeKernel
+ *   PrecisionPerturbation  doubles relative to a HighPrecision reference orbit
+**/
+enum PrecisionTier {
+	PrecisionDouble,
+	PrecisionDoubleDouble,
+	PrecisionPerturbation,
+};
+
+/**
+ * Per-thread counters of one pass, merged into a per-frame total.
+**/
+struct RenderStats {
+	KernelStats kernel;
+	PerturbationStats perturbation;
+	unsigned long long pixelsIterated = 0;
+	unsigned long long pixelsFilled = 0;
+	unsigned long long pixelsReused = 0;
+	unsigned long long pixelsResumed = 0;
+	unsigned long long pixelsSupersampled = 0;
+	// Sum of escape counts, capped at the limit: the work of a plain renderer.
+	unsigned long long iterations = 0;
+	int blackPixels = 0;
+	void Add(const RenderStats & other) {
+		kernel.Add(other.kernel);
+		perturbation.Add(other.perturbation);
+		pixelsIterated += other.pixelsIterated;
+		pixelsFilled += other.pixelsFilled;
+		pixelsReused += other.pixelsReused;
+		pixelsResumed += other.pixelsResumed;
+		pixelsSupersampled += other.pixelsSupersampled;
+		iterations += other.iterations;
+		blackPixels += other.blackPixels;
+	}
+};
+
+/**
+ * Per-pixel outcome of the last double-precision pass, kept so that after a
+ * 2x zoom onto a quadrant the quarter of the new pixels that land on old
+ * sample points (even rows and columns) need no fresh iteration:
+ *   Escaped  iterations holds the escape count, valid for any limit
+ *   Bounded  not escaped after `iterations` steps; zx/zy let a higher limit
+ *            resume from there
+ *   Proven   bounded for good (interior test or detected cycle)
+ *   Unknown  filled by subdivision rather than iterated
+**/
+struct FrameHistory {
+	enum State : UBYTE {
+		Unknown,
+		Escaped,
+		Bounded,
+		Proven,
+	};
+	bool valid = false;
+	HighPrecision centerReal;
+	HighPrecision centerImag;
+	double w = 0.0;
+	double h = 0.0;
+	int width = 0;
+	int height = 0;
+	std::vector < UBYTE > state;
+	std::vector < int > iterations;
+	std::vector < double > zx;
+	std::vector < double > zy;
+	void Reset(int width, int height) {
+		this->width = width;
+		this->height = height;
+		state.assign(width * height, Unknown);
+		iterations.resize(width * height);
+		zx.resize(width * height);
+		zy.resize(width * height);
+	};
+};
+
+/**
+ * Sub-window of the current view considered as the next zoom target: centre
+ * offset from the current centre and width as a fraction of the current one.
+**/
+struct ZoomCandidate {
+	double offsetX;
+	double offsetY;
+	double scale;
+	double score;
+};
 
 class MandelbrotSet {
 	public: void InitMandelbrotSet();
@@ -7,11 +146,201 @@ class MandelbrotSet {
 	UBYTE * GetRender() {
 		return rendered;
 	};
+	/**
+	 * View, iteration limit and black share of the last accepted frame.
+	**/
+	FrameInfo GetFrameInfo() const {
+		FrameInfo info;
+		info.centerX = x;
+		info.centerY = y;
+		info.width = w;
+		info.iterations = kernelOptions.iterations;
+		info.blackRatio = blackRatio;
+		return info;
+	};
 	void ZoomOnInterestingArea();
-	private: bool IsMandelPoint(double x, double y, int iterations);
+	void SetInteriorTests(unsigned tests) {
+		interiorTests = tests;
+	};
+	void SetPeriodicityCheck(bool enabled) {
+		periodicityCheck = enabled;
+	};
+	void SetRenderMode(RenderMode mode) {
+		renderMode = mode;
+	};
+	void SetFrameReuse(bool enabled) {
+		frameReuse = enabled;
+	};
+	/**
+	 * With ShadeGray4 the image passed to SetRender must be a Paint scale 4
+	 * image; the 1bpp plane still decides which frames are accepted.
+	**/
+	void SetShadeMode(ShadeMode mode) {
+		shadeMode = mode;
+	};
+	/**
+	 * Draws the 1bpp image by dithering a tone taken from the normalized
+	 * iteration count, black inside the set, instead of black inside and
+	 * white outside. Error diffusion runs on each band of rows as soon as
+	 * the tiles covering it are done, while the rest of the frame renders;
+	 * ordered dithering runs inside each tile. Which frames are accepted
+	 * still depends on the set alone.
+	**/
+	void SetDitherMode(DitherMode mode) {
+		ditherMode = mode;
+	};
+	/**
+	 * After each pass, supersamples the pixels whose 3x3 neighbourhood holds
+	 * both inside and outside pixels at samples (4 or 16; 1 turns it off)
+	 * points each, and shades them by the share and the escape counts of
+	 * those points. Applies to gray and dithered output; the 1bpp set plane,
+	 * and with it which frames are accepted, stays as rendered.
+	**/
+	void SetAntialiasing(int samples, SamplePattern pattern = SampleRotatedGrid) {
+		antialiasGrid = samples >= 16 ? 4 : samples >= 4 ? 2 : 1;
+		samplePattern = pattern;
+	};
+	/**
+	 * Draws black every pixel that the exterior distance estimate puts within
+	 * pixels pixel widths of the set (0 turns it off), so that filaments
+	 * thinner than a pixel survive in the 1bpp frame even where no sample
+	 * point lands on them. This changes which frames are accepted: deep
+	 * views keep enough black far more often. Costs about one more complex
+	 * multiply per iteration.
+	**/
+	void SetDistanceEstimation(double pixels) {
+		distancePixels = pixels;
+	};
+	/**
+	 * Fractal to explore, from the next InitMandelbrotSet on; (juliaX,
+	 * juliaY) is the constant of FormulaJulia, by default the Douady rabbit.
+	 * Exploration and validation are the same for every formula, but only
+	 * the Mandelbrot set zooms on past double precision: for the others the
+	 * zoom is exhausted there.
+	**/
+	void SetFormula(FractalFormula formula, double juliaX = -0.12256116687665365, double juliaY = 0.7448617666197442) {
+		kernelOptions.formula = formula;
+		kernelOptions.juliaX = juliaX;
+		kernelOptions.juliaY = juliaY;
+		// Kept orbits belong to the old formula.
+		history.valid = false;
+	};
+	/**
+	 * Makes the next Render draw exactly this view (height follows from the
+	 * aspect ratio), whatever its black share, instead of zooming on from the
+	 * last frame. Later Renders zoom on from it as usual.
+	**/
+	void SetView(double centerX, double centerY, double width);
+	/**
+	 * Counters of the last Render call, all passes and retries included.
+	**/
+	const RenderStats & GetRenderStats() const {
+		return frameStats;
+	};
+	int GetRetries() const {
+		return retries;
+	};
+	double GetThreadUtilization() const {
+		return scheduler.Utilization();
+	};
+	unsigned GetThreadCount() const {
+		return scheduler.ThreadCount();
+	};
+	/**
+	 * Seeds every random exploration decision; the same seed from the same
+	 * starting view gives the same sequence of frames.
+	**/
+	void SetSeed(uint64_t seed) {
+		rng.Seed(seed);
+	};
+	/**
+	 * Writes the exploration state (exact centre, view size, zoom count,
+	 * generator state, precision tier) to path through a temporary file and
+	 * rename(), so the file is always complete.
+	**/
+	bool SaveState(const char * path);
+	/**
+	 * Restores a state written by SaveState; the next Render zooms on from
+	 * there. Returns false, changing nothing, if the file is missing or bad.
+	**/
+	bool LoadState(const char * path);
+	/**
+	 * True once the view is narrower than perturbation can resolve and the
+	 * zoom has to start over.
+	**/
+	bool IsZoomExhausted() const {
+		if(kernelOptions.formula != FormulaMandelbrot && renderedResX > 0) {
+			return w / renderedResX < DoubleMinPixel * std::max(1.0, std::max(std::fabs(x), std::fabs(y)));
+		}
+		return w < MinimumWidth;
+	};
+	private: static constexpr int TileSize = 64;
+	static constexpr const char * StateMagic = "PiArtFrame-state";
+	static constexpr int StateVersion = 2;
+	// Pixel offsets are plain doubles, which turn subnormal around 1e-308.
+	static constexpr double MinimumWidth = 1e-290;
+	// Smallest pixel, relative to the coordinate, each tier still resolves.
+	// Doubles stop 64 ulps short of aliasing neighbours; double-double needs
+	// far more headroom, since its rounding error is amplified over the
+	// thousands of iterations such depths take.
+	static constexpr double DoubleMinPixel = 64.0 * DBL_EPSILON;
+	static constexpr double DoubleDoubleMinPixel = 1e-24;
+	static constexpr int MinSubdivisionArea = 36;
+	// A frame is accepted when this fraction of its pixels is black.
+	static constexpr double MinBlackFraction = 0.2;
+	static constexpr double MaxBlackFraction = 0.9;
+	// How many of the zoom candidates ranked by the last frame get a probe.
+	static constexpr int SearchProbes = 8;
+	// ProbeView samples every ProbeStride-th pixel in each direction and
+	// rejects a view only when the black fraction lies outside the band by
+	// more than ProbeConfidence standard errors plus ProbeSlack.
+	static constexpr int ProbeStride = 8;
+	static constexpr double ProbeConfidence = 3.0;
+	static constexpr double ProbeSlack = 0.02;
+	// Entries of the dither tone curve, spread evenly over the probed counts.
+	static constexpr int ToneMapSize = 256;
+	enum PixelClass : UBYTE {
+		// Inside is 1 so that a row of classes is PackedFrame's black mask.
+		PixelOutside = 0,
+		PixelInside = 1,
+		PixelUnknown = 0xFF,
+	};
+	void PreparePass(UWORD xResolution, UWORD yResolution);
+	bool ProbeView(UWORD xResolution, UWORD yResolution, double minBlackFraction, double maxBlackFraction);
+	int RenderPass(UWORD xResolution, UWORD yResolution);
+	void SetCenter(double centerX, double centerY);
+	void MoveCenter(double offsetX, double offsetY);
+	void SeedFromHistory(UWORD xResolution, UWORD yResolution);
+	void SearchZoomTargets();
+	void ProbeCandidate(const ZoomCandidate & candidate, int columns, int rows, int limit, UBYTE * black, RenderStats & stats);
+	void ApplyZoomCandidate(const ZoomCandidate & candidate);
+	bool NextZoomCandidate();
+	bool ZoomIntoCandidates();
+	void Iterate(const double * cx, const double * cy, const double * cxLo, const double * cyLo, int count, int * escapeIter, RenderStats & stats, const int * pixels = nullptr, float * smooth = nullptr);
+	void RenderTile(const Tile & tile, RenderStats & stats);
+	void Subdivide(UBYTE * classes, UBYTE * levels, int tileWidth, const Tile & tile, int x0, int y0, int x1, int y1, RenderStats & stats);
+	void EvaluateLine(UBYTE * classes, UBYTE * levels, int tileWidth, const Tile & tile, int ax, int ay, int bx, int by, RenderStats & stats);
+	UBYTE ShadeLevel(float smooth) const;
+	/**
+	 * Gray and dither both need the normalized count of every pixel.
+	**/
+	bool KeepsSmoothField() const {
+		return shadeMode == ShadeGray4 || ditherMode != DitherNone;
+	};
+	void BuildToneMap();
+	UBYTE Tone(float smooth) const;
+	void DitherReadyBands(std::vector < std::atomic < int > > & bandTiles, int bandHeight, UWORD yResolution);
+	bool Antialiases() const {
+		return antialiasGrid > 1 && KeepsSmoothField();
+	};
+	void AntialiasRow(int y, RenderStats & stats);
+	/**
+	 * Dither tones of count pixels of row y from x: black inside the set, the
+	 * supersampled tone on antialiased pixels, Tone() of the count otherwise.
+	**/
+	void ToneRow(int x, int y, int count, UBYTE * tone) const;
 	unsigned long long GetUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv);
 	bool IsAreaUniform(int xOffset, int yOffset, double fW, double fH, int wDiv, int hDiv, double wStart, double hStart);
-	double GetImprovedUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv);
 	UBYTE * rendered;
 	double w;
 	double h;
@@ -21,4 +350,95 @@ class MandelbrotSet {
 	UWORD renderedResY;
 	double centerX;
 	double centerY;
+	/**
+	 * Exact view centre; x and y are its rounded copies.
+	**/
+	HighPrecision centerReal;
+	HighPrecision centerImag;
+	PrecisionTier precisionTier = PrecisionDouble;
+	float blackRatio = 0.0f;
+	int imageIndex = 0;
+	// Set by SetView: the next frame is drawn as given, not searched for.
+	bool viewFixed = false;
+	int retries = 0;
+	unsigned long long zoomCount = 0;
+	Rng rng;
+	PerturbationOrbit orbit;
+	TileScheduler scheduler;
+	unsigned interiorTests = EscapeKernel::InteriorDefault;
+	bool periodicityCheck = true;
+	RenderMode renderMode = RenderPerPixel;
+	ShadeMode shadeMode = ShadeBlackWhite;
+	DitherMode ditherMode = DitherNone;
+	// Subsamples per side of an antialiased pixel; 1 is off.
+	int antialiasGrid = 1;
+	SamplePattern samplePattern = SampleRotatedGrid;
+	// Distance estimate threshold in pixels; 0 is off.
+	double distancePixels = 0.0;
+	bool frameReuse = true;
+	KernelOptions kernelOptions;
+	std::vector < double > columnX;
+	std::vector < double > rowY;
+	// Low parts of the coordinates in the double-double tier.
+	std::vector < double > columnXLo;
+	std::vector < double > rowYLo;
+	RenderStats frameStats;
+	PackedFrame frame;
+	/**
+	 * Black counts of the last rendered frame, or of the probe samples of the
+	 * last rejected view; current only until the view moves.
+	**/
+	BitplaneStats regionStats;
+	bool regionStatsCurrent = false;
+	std::vector < UBYTE > probeImage;
+	std::vector < UBYTE > edgePlane;
+	BitplaneStats edgeStats;
+	/**
+	 * Zoom targets found by the last search, best first, as sub-windows of
+	 * the parent view; a rejected target falls back to the next one.
+	**/
+	std::vector < ZoomCandidate > zoomCandidates;
+	size_t zoomCandidateIndex = 0;
+	HighPrecision parentReal;
+	HighPrecision parentImag;
+	double parentW = 0.0;
+	double parentH = 0.0;
+	FrameHistory history;
+	FrameHistory previousHistory;
+	// Escape count carried over from the previous frame per pixel, or -1.
+	std::vector < int > seedIter;
+	/**
+	 * Normalized iteration count per pixel of the current and the previous
+	 * pass, kept with ShadeGray4 or dithering only.
+	**/
+	std::vector < float > smoothIter;
+	std::vector < float > previousSmoothIter;
+	/**
+	 * Sorted normalized counts of the outside probe samples of the view; a
+	 * pixel's rank among them picks its gray.
+	**/
+	std::vector < float > toneSamples;
+	// Counts from which a pixel is one and two grays darker than white.
+	float grayThreshold[2] = {FLT_MAX, FLT_MAX};
+	/**
+	 * Dither tone (255 white) at ToneMapSize counts from toneLow in steps of
+	 * 1 / toneScale: one minus the square of the count's quantile among the
+	 * probe samples, so that the bulk of the outside stays light and the
+	 * slow-escaping filaments near the set go dark.
+	**/
+	std::vector < UBYTE > toneMap;
+	float toneLow = 0.0f;
+	float toneScale = 0.0f;
+	ErrorDiffusion diffusion;
+	// Bands are dithered in order, by whichever worker finishes one.
+	std::mutex ditherMutex;
+	size_t nextDitherBand = 0;
+	std::vector < UBYTE > ditherTone;
+	std::vector < UBYTE > ditherBlack;
+	/**
+	 * Pixels of the pass picked for supersampling, black in a plane laid out
+	 * like the frame, and their dither tones.
+	**/
+	std::vector < UBYTE > mixedPlane;
+	std::vector < UBYTE > antialiasTone;
 };
@@ -0,0 +1,167 @@
+#include "ordered_dither.hpp"
+
+/**
+ * Bayer index matrix M8 scaled to thresholds: M8 * 255 / 64 + 1.
+**/
+static const UBYTE BayerThresholds[8 * 8] = {
+	1, 128, 32, 160, 8, 136, 40, 168,
+	192, 64, 224, 96, 200, 72, 232, 104,
+	48, 176, 16, 144, 56, 184, 24, 152,
+	240, 112, 208, 80, 248, 120, 216, 88,
+	12, 140, 44, 172, 4, 132, 36, 164,
+	204, 76, 236, 108, 196, 68, 228, 100,
+	60, 188, 28, 156, 52, 180, 20, 148,
+	252, 124, 220, 92, 244, 116, 212, 84,
+};
+
+/**
+ * Void-and-cluster ranks (Ulichney 1993; toroidal Gaussian energy, sigma
+ * 1.5, 10% initial pattern) scaled to thresholds: rank * 255 / 4096 + 1.
+ * Any threshold level picks a well-spread subset of pixels, without the
+ * cross-hatch of the Bayer matrix.
+**/
+static const UBYTE BlueNoiseThresholds[64 * 64] = {
+	26, 231, 47, 211, 152, 237, 34, 79, 247, 50, 148, 107, 250, 120, 209, 69, 243, 36, 174, 140, 63, 152, 251, 135, 225, 92, 244, 175, 78, 100, 120, 28,
+	87, 114, 240, 63, 107, 43, 178, 30, 86, 212, 169, 23, 187, 120, 222, 76, 243, 44, 95, 29, 185, 109, 232, 163, 32, 135, 225, 49, 207, 78, 184, 219,
+	87, 115, 180, 29, 98, 54, 115, 175, 134, 91, 185, 24, 167, 44, 181, 2, 110, 132, 83, 226, 203, 111, 28, 79, 180, 24, 128, 6, 208, 46, 168, 251,
+	200, 46, 155, 25, 225, 159, 119, 240, 138, 105, 38, 81, 231, 62, 39, 190, 3, 145, 209, 70, 251, 9, 129, 66, 247, 194, 100, 146, 31, 131, 3, 57,
+	241, 140, 66, 251, 161, 190, 231, 1, 211, 37, 227, 78, 215, 93, 234, 153, 201, 56, 188, 10, 42, 89, 167, 210, 50, 154, 220, 59, 148, 227, 14, 66,
+	130, 176, 79, 186, 97, 5, 199, 60, 13, 195, 254, 158, 131, 204, 154, 114, 86, 229, 119, 160, 54, 203, 173, 40, 112, 5, 71, 176, 249, 197, 108, 174,
+	154, 12, 215, 109, 17, 83, 145, 69, 108, 158, 124, 53, 140, 18, 122, 80, 29, 251, 160, 121, 240, 184, 125, 17, 242, 104, 81, 196, 106, 134, 184, 95,
+	216, 9, 234, 126, 206, 50, 89, 228, 152, 71, 113, 49, 7, 96, 22, 250, 171, 48, 17, 221, 101, 142, 78, 219, 186, 156, 235, 21, 94, 63, 226, 35,
+	192, 96, 42, 201, 131, 221, 34, 197, 254, 23, 193, 243, 164, 204, 62, 174, 216, 97, 22, 75, 150, 55, 223, 69, 137, 189, 38, 250, 19, 73, 239, 30,
+	152, 109, 61, 32, 147, 250, 171, 122, 185, 27, 222, 168, 236, 179, 213, 65, 136, 196, 79, 181, 32, 240, 15, 95, 138, 50, 200, 126, 41, 159, 134, 76,
+	118, 233, 166, 72, 178, 51, 123, 169, 56, 99, 74, 6, 106, 37, 238, 144, 45, 134, 225, 200, 107, 11, 195, 92, 164, 3, 123, 175, 153, 48, 117, 193,
+	45, 248, 166, 221, 105, 72, 18, 39, 95, 207, 128, 88, 68, 142, 45, 107, 27, 232, 124, 151, 51, 192, 120, 230, 29, 75, 105, 224, 172, 212, 8, 246,
+	21, 59, 141, 6, 247, 94, 235, 12, 149, 213, 171, 137, 220, 88, 191, 16, 114, 185, 58, 164, 38, 255, 143, 34, 232, 202, 54, 85, 234, 208, 168, 80,
+	138, 200, 90, 11, 180, 131, 223, 149, 240, 56, 10, 201, 31, 117, 238, 200, 168, 96, 11, 255, 106, 163, 65, 202, 169, 243, 147, 14, 80, 113, 51, 178,
+	219, 85, 203, 114, 152, 26, 185, 112, 82, 231, 27, 186, 52, 126, 160, 71, 243, 86, 3, 236, 125, 78, 179, 116, 64, 105, 222, 139, 30, 98, 5, 232,
+	22, 69, 127, 42, 210, 53, 193, 81, 110, 177, 138, 247, 186, 159, 2, 77, 145, 54, 206, 72, 216, 7, 129, 42, 89, 25, 183, 60, 251, 189, 92, 151,
+	123, 169, 33, 229, 78, 213, 63, 205, 133, 46, 109, 70, 249, 9, 226, 36, 172, 209, 147, 100, 205, 53, 218, 21, 246, 157, 12, 188, 66, 128, 150, 214,
+	105, 174, 244, 150, 93, 237, 1, 162, 27, 217, 73, 103, 49, 91, 219, 40, 245, 185, 134, 37, 176, 92, 245, 155, 219, 134, 211, 117, 37, 138, 236, 28,
+	57, 255, 103, 52, 174, 137, 40, 166, 5, 242, 158, 206, 147, 112, 199, 95, 132, 22, 66, 186, 26, 154, 94, 170, 130, 46, 91, 166, 204, 254, 50, 183,
+	33, 59, 207, 20, 168, 115, 67, 129, 253, 45, 152, 14, 229, 132, 177, 120, 88, 17, 104, 237, 144, 22, 191, 61, 108, 2, 81, 165, 204, 10, 72, 210,
+	146, 2, 195, 127, 13, 245, 101, 223, 75, 185, 92, 21, 41, 78, 154, 55, 253, 116, 230, 47, 137, 242, 9, 190, 71, 210, 237, 36, 113, 14, 88, 121,
+	235, 141, 111, 82, 220, 36, 181, 202, 93, 172, 207, 112, 193, 59, 23, 205, 164, 223, 58, 198, 76, 120, 227, 32, 175, 248, 49, 230, 98, 157, 111, 181,
+	94, 68, 156, 218, 83, 186, 24, 122, 145, 53, 220, 132, 239, 179, 219, 11, 191, 79, 165, 213, 110, 75, 221, 115, 28, 148, 106, 76, 219, 154, 195, 72,
+	164, 4, 185, 49, 136, 241, 148, 12, 59, 123, 23, 239, 82, 156, 252, 71, 34, 147, 115, 3, 168, 43, 152, 84, 125, 194, 145, 28, 59, 191, 233, 38,
+	241, 208, 115, 31, 236, 148, 67, 202, 253, 15, 111, 165, 61, 100, 33, 136, 158, 37, 97, 6, 179, 33, 161, 55, 252, 198, 1, 140, 179, 47, 244, 24,
+	212, 90, 249, 204, 16, 78, 104, 213, 236, 78, 146, 39, 180, 5, 138, 106, 235, 82, 182, 251, 218, 95, 201, 240, 14, 67, 103, 211, 129, 84, 20, 133,
+	177, 17, 167, 58, 107, 45, 171, 94, 39, 180, 83, 209, 1, 195, 121, 226, 64, 239, 203, 126, 246, 88, 195, 133, 93, 176, 64, 235, 22, 126, 101, 148,
+	40, 129, 62, 158, 117, 189, 52, 33, 159, 184, 209, 101, 126, 225, 51, 175, 199, 13, 48, 132, 65, 24, 138, 55, 163, 234, 180, 9, 252, 170, 205, 51,
+	104, 81, 250, 140, 195, 216, 4, 227, 116, 153, 233, 45, 143, 248, 73, 170, 107, 16, 145, 44, 61, 150, 234, 10, 42, 157, 119, 204, 89, 223, 67, 190,
+	232, 176, 100, 31, 230, 167, 251, 132, 109, 8, 54, 244, 70, 202, 95, 29, 124, 158, 211, 104, 162, 187, 111, 207, 31, 117, 82, 154, 38, 116, 71, 146,
+	230, 44, 186, 11, 86, 123, 160, 77, 191, 22, 69, 126, 182, 91, 18, 47, 210, 185, 82, 168, 217, 22, 118, 73, 207, 240, 27, 53, 137, 172, 6, 116,
+	56, 14, 220, 142, 73, 6, 90, 196, 68, 233, 140, 30, 168, 16, 153, 247, 62, 232, 85, 33, 224, 9, 249, 77, 144, 215, 50, 223, 98, 237, 4, 215,
+	25, 157, 121, 65, 224, 31, 249, 53, 133, 242, 102, 220, 34, 206, 148, 238, 132, 30, 252, 112, 191, 99, 226, 178, 143, 103, 81, 188, 248, 39, 211, 165,
+	252, 86, 199, 115, 47, 214, 146, 22, 218, 164, 84, 196, 117, 221, 79, 183, 108, 20, 144, 194, 70, 128, 43, 99, 172, 19, 189, 138, 64, 160, 180, 126,
+	197, 96, 238, 204, 169, 143, 96, 200, 35, 173, 7, 162, 60, 112, 176, 77, 101, 58, 140, 4, 70, 36, 136, 50, 20, 214, 164, 12, 110, 148, 76, 98,
+	136, 29, 150, 183, 242, 108, 174, 58, 124, 39, 106, 255, 60, 144, 42, 131, 217, 51, 172, 117, 236, 179, 151, 228, 63, 246, 108, 10, 203, 33, 88, 57,
+	143, 72, 18, 41, 107, 60, 15, 155, 113, 211, 88, 139, 252, 24, 217, 11, 196, 230, 175, 212, 158, 236, 195, 91, 254, 64, 131, 220, 58, 230, 21, 194,
+	48, 223, 66, 11, 83, 32, 203, 93, 229, 191, 23, 175, 7, 99, 240, 12, 197, 90, 253, 1, 56, 86, 18, 191, 37, 125, 80, 169, 240, 115, 211, 253,
+	111, 165, 192, 133, 245, 176, 208, 238, 74, 55, 232, 193, 76, 132, 53, 164, 123, 38, 81, 106, 52, 123, 9, 151, 171, 107, 39, 192, 89, 181, 127, 243,
+	155, 102, 175, 235, 132, 159, 250, 4, 144, 75, 134, 222, 153, 205, 178, 65, 148, 113, 37, 208, 158, 218, 111, 135, 208, 159, 226, 26, 67, 150, 45, 13,
+	229, 51, 218, 92, 2, 77, 119, 24, 188, 149, 11, 39, 108, 182, 225, 90, 244, 154, 16, 186, 246, 86, 218, 71, 205, 18, 234, 144, 8, 157, 41, 73,
+	2, 203, 120, 46, 197, 65, 117, 47, 181, 239, 55, 92, 38, 73, 122, 29, 231, 167, 75, 139, 102, 29, 245, 74, 5, 97, 47, 192, 127, 177, 96, 186,
+	128, 21, 69, 149, 184, 222, 139, 45, 106, 226, 124, 166, 239, 31, 149, 2, 60, 110, 221, 136, 22, 169, 33, 126, 48, 178, 119, 75, 251, 103, 213, 117,
+	227, 80, 31, 165, 95, 18, 217, 151, 99, 14, 210, 115, 248, 166, 219, 100, 193, 17, 242, 186, 66, 195, 166, 50, 182, 255, 140, 85, 222, 4, 244, 74,
+	208, 173, 249, 118, 32, 57, 163, 255, 84, 179, 50, 92, 197, 66, 102, 207, 171, 192, 75, 47, 204, 99, 231, 145, 247, 93, 216, 51, 197, 26, 172, 55,
+	184, 146, 255, 208, 136, 231, 173, 69, 201, 128, 169, 28, 141, 3, 56, 137, 41, 87, 123, 47, 13, 236, 118, 145, 218, 109, 23, 206, 59, 113, 157, 34,
+	145, 106, 45, 199, 231, 95, 191, 9, 206, 27, 142, 215, 19, 136, 247, 43, 126, 30, 255, 163, 115, 60, 182, 77, 1, 161, 31, 138, 165, 88, 233, 137,
+	18, 100, 62, 10, 83, 44, 108, 26, 243, 42, 80, 193, 229, 88, 199, 245, 157, 212, 173, 226, 152, 91, 35, 81, 13, 64, 175, 155, 38, 236, 189, 88,
+	221, 6, 78, 155, 16, 113, 68, 127, 152, 63, 246, 77, 115, 185, 162, 80, 230, 98, 144, 14, 236, 138, 24, 209, 111, 194, 66, 230, 10, 121, 69, 37,
+	201, 236, 126, 187, 161, 247, 195, 141, 90, 218, 156, 62, 108, 173, 20, 114, 61, 9, 104, 73, 130, 198, 215, 163, 239, 196, 122, 228, 100, 137, 16, 60,
+	122, 194, 237, 135, 176, 213, 243, 33, 224, 103, 175, 5, 235, 54, 26, 212, 8, 180, 56, 214, 87, 40, 225, 153, 53, 240, 129, 101, 210, 182, 246, 155,
+	84, 168, 49, 218, 30, 121, 63, 1, 179, 113, 19, 254, 40, 134, 221, 82, 186, 141, 248, 30, 178, 8, 57, 101, 134, 43, 87, 21, 72, 212, 176, 253,
+	160, 94, 57, 28, 85, 48, 160, 88, 185, 46, 123, 155, 199, 98, 131, 150, 111, 203, 76, 127, 169, 196, 95, 124, 13, 85, 175, 41, 145, 56, 22, 115,
+	223, 5, 109, 78, 153, 96, 211, 165, 233, 57, 198, 146, 185, 70, 28, 160, 233, 37, 201, 63, 221, 113, 251, 188, 17, 219, 148, 248, 165, 50, 109, 25,
+	38, 141, 182, 217, 128, 193, 3, 133, 209, 21, 231, 83, 35, 225, 64, 249, 44, 160, 31, 243, 4, 61, 248, 163, 190, 221, 25, 254, 79, 195, 94, 178,
+	40, 142, 195, 238, 15, 230, 48, 129, 30, 85, 125, 6, 98, 239, 209, 119, 54, 96, 126, 158, 84, 143, 37, 78, 159, 62, 114, 190, 1, 133, 199, 76,
+	207, 239, 9, 105, 251, 65, 112, 239, 74, 149, 60, 181, 136, 166, 13, 184, 87, 228, 104, 189, 150, 118, 30, 74, 43, 140, 97, 162, 3, 229, 130, 215,
+	74, 252, 59, 170, 133, 73, 199, 100, 249, 151, 208, 231, 51, 154, 84, 12, 192, 168, 2, 240, 25, 172, 205, 125, 232, 177, 27, 80, 228, 95, 244, 170,
+	89, 121, 70, 164, 37, 151, 202, 41, 170, 108, 254, 8, 212, 110, 73, 125, 214, 16, 137, 48, 84, 215, 181, 227, 109, 198, 57, 212, 111, 153, 49, 17,
+	164, 123, 23, 101, 189, 35, 159, 8, 177, 42, 68, 112, 174, 33, 201, 131, 252, 74, 213, 106, 52, 223, 97, 5, 49, 102, 204, 128, 58, 154, 15, 48,
+	225, 26, 196, 232, 87, 12, 226, 96, 18, 196, 129, 92, 51, 234, 200, 35, 152, 61, 196, 239, 167, 15, 94, 144, 8, 241, 128, 31, 183, 70, 235, 105,
+	187, 85, 228, 50, 213, 116, 242, 139, 79, 221, 190, 23, 139, 243, 103, 59, 148, 43, 181, 133, 191, 71, 140, 243, 188, 144, 254, 40, 217, 186, 115, 146,
+	178, 130, 55, 139, 186, 117, 174, 137, 56, 216, 32, 188, 156, 20, 96, 172, 252, 112, 91, 28, 69, 127, 252, 55, 176, 72, 166, 90, 249, 13, 198, 148,
+	37, 205, 140, 161, 14, 87, 56, 201, 105, 16, 156, 91, 216, 72, 182, 25, 227, 116, 21, 86, 235, 15, 165, 34, 89, 66, 10, 168, 92, 21, 209, 65,
+	4, 253, 95, 29, 218, 46, 70, 238, 160, 82, 230, 68, 118, 242, 141, 56, 2, 183, 229, 147, 217, 187, 36, 204, 119, 23, 224, 49, 144, 122, 83, 59,
+	239, 5, 69, 246, 127, 227, 170, 28, 234, 132, 253, 46, 118, 3, 151, 207, 94, 166, 245, 150, 41, 110, 203, 123, 214, 161, 112, 235, 139, 76, 240, 102,
+	42, 149, 206, 161, 80, 249, 20, 194, 114, 12, 133, 172, 41, 191, 80, 209, 130, 76, 40, 118, 18, 100, 162, 78, 234, 152, 195, 109, 209, 33, 177, 214,
+	130, 108, 179, 94, 41, 190, 77, 120, 52, 176, 70, 202, 172, 232, 54, 130, 77, 7, 190, 63, 217, 179, 80, 53, 232, 26, 198, 46, 184, 31, 157, 194,
+	216, 66, 112, 14, 179, 125, 149, 93, 39, 183, 251, 99, 6, 223, 108, 24, 239, 160, 205, 173, 59, 226, 137, 1, 104, 43, 81, 10, 160, 244, 100, 22,
+	166, 50, 202, 25, 219, 144, 3, 156, 212, 96, 10, 127, 34, 97, 188, 249, 39, 222, 103, 126, 26, 141, 247, 9, 150, 96, 70, 130, 223, 108, 57, 125,
+	89, 172, 243, 51, 98, 213, 59, 204, 226, 147, 54, 209, 163, 63, 151, 185, 50, 98, 14, 250, 85, 197, 48, 245, 207, 134, 187, 229, 51, 68, 139, 224,
+	80, 255, 114, 157, 67, 104, 250, 194, 36, 230, 148, 244, 80, 159, 19, 110, 168, 145, 51, 240, 169, 69, 105, 192, 127, 174, 250, 3, 84, 167, 247, 12,
+	228, 29, 130, 193, 232, 33, 167, 1, 76, 110, 27, 85, 129, 246, 35, 121, 226, 142, 71, 123, 155, 20, 111, 170, 67, 18, 165, 95, 124, 202, 7, 188,
+	36, 142, 12, 233, 187, 47, 133, 89, 68, 115, 180, 57, 210, 137, 227, 65, 215, 15, 200, 91, 11, 205, 43, 227, 31, 57, 213, 154, 206, 26, 187, 138,
+	199, 79, 155, 10, 69, 142, 116, 247, 135, 171, 237, 199, 16, 102, 213, 79, 7, 178, 209, 36, 183, 238, 144, 88, 222, 116, 253, 35, 151, 237, 86, 116,
+	162, 60, 212, 86, 123, 19, 215, 173, 12, 206, 31, 105, 15, 190, 44, 89, 124, 181, 73, 141, 223, 113, 156, 81, 182, 116, 92, 44, 122, 67, 99, 39,
+	114, 57, 238, 101, 171, 219, 88, 26, 187, 46, 68, 149, 177, 53, 192, 161, 241, 112, 54, 224, 99, 65, 34, 191, 25, 59, 199, 76, 16, 171, 47, 217,
+	241, 103, 175, 38, 154, 244, 60, 146, 240, 129, 165, 220, 74, 114, 241, 162, 31, 251, 109, 38, 176, 58, 255, 7, 144, 237, 15, 192, 241, 147, 217, 162,
+	4, 178, 211, 124, 39, 190, 56, 233, 102, 206, 7, 116, 228, 138, 20, 97, 64, 29, 153, 130, 4, 202, 124, 233, 155, 177, 139, 220, 110, 193, 134, 27,
+	74, 2, 131, 202, 72, 101, 192, 36, 94, 69, 46, 255, 144, 174, 1, 135, 207, 56, 154, 235, 19, 125, 193, 97, 219, 69, 135, 171, 82, 18, 53, 254,
+	91, 143, 23, 77, 250, 19, 157, 131, 75, 159, 254, 91, 36, 77, 248, 146, 198, 233, 173, 74, 255, 163, 80, 51, 102, 6, 89, 42, 245, 60, 92, 206,
+	149, 184, 250, 24, 222, 169, 5, 121, 223, 157, 198, 21, 91, 58, 217, 102, 80, 16, 186, 96, 210, 78, 152, 26, 49, 199, 102, 30, 227, 110, 203, 131,
+	190, 235, 49, 201, 139, 109, 214, 12, 224, 34, 135, 191, 216, 113, 183, 40, 124, 89, 14, 189, 107, 23, 217, 134, 246, 204, 121, 183, 147, 8, 167, 234,
+	119, 54, 87, 113, 44, 134, 237, 82, 180, 11, 104, 128, 181, 234, 32, 195, 165, 226, 120, 66, 142, 36, 243, 173, 119, 158, 249, 62, 150, 179, 77, 35,
+	64, 113, 160, 93, 176, 59, 85, 179, 119, 62, 173, 21, 56, 163, 2, 220, 58, 208, 140, 46, 225, 147, 41, 185, 19, 62, 228, 27, 75, 198, 108, 40,
+	20, 227, 166, 199, 152, 66, 196, 50, 142, 246, 65, 208, 49, 152, 122, 64, 139, 42, 247, 7, 200, 224, 105, 64, 216, 1, 40, 188, 124, 9, 220, 155,
+	14, 208, 32, 226, 3, 244, 199, 45, 240, 97, 212, 82, 125, 232, 74, 107, 158, 25, 242, 97, 67, 197, 116, 94, 168, 143, 86, 164, 217, 130, 252, 84,
+	187, 135, 71, 11, 241, 99, 22, 217, 112, 31, 161, 231, 23, 84, 250, 9, 220, 88, 176, 156, 52, 128, 14, 185, 85, 131, 204, 94, 231, 52, 102, 245,
+	87, 172, 126, 72, 147, 117, 23, 137, 162, 5, 149, 246, 179, 39, 143, 252, 190, 80, 177, 129, 166, 6, 248, 73, 216, 39, 242, 106, 48, 17, 64, 161,
+	208, 48, 105, 214, 36, 182, 131, 166, 75, 200, 90, 136, 112, 194, 169, 104, 191, 29, 111, 71, 189, 90, 150, 228, 47, 239, 146, 68, 22, 164, 196, 136,
+	217, 51, 252, 189, 44, 169, 103, 222, 74, 197, 49, 103, 18, 201, 93, 12, 122, 38, 219, 19, 233, 60, 155, 30, 188, 127, 1, 195, 139, 178, 225, 117,
+	4, 246, 143, 168, 119, 82, 245, 10, 227, 45, 184, 3, 216, 44, 73, 144, 54, 128, 229, 207, 23, 253, 35, 116, 163, 18, 108, 177, 253, 127, 72, 24,
+	146, 110, 9, 93, 215, 237, 61, 183, 34, 121, 231, 138, 68, 162, 230, 62, 210, 142, 55, 110, 89, 207, 122, 224, 104, 59, 161, 70, 238, 89, 34, 149,
+	98, 73, 28, 228, 60, 203, 47, 105, 150, 124, 251, 61, 153, 237, 16, 208, 245, 162, 3, 97, 133, 170, 210, 77, 193, 60, 220, 38, 90, 212, 42, 181,
+	79, 224, 165, 138, 29, 84, 11, 133, 253, 83, 23, 187, 222, 119, 43, 184, 100, 161, 248, 196, 174, 44, 145, 17, 171, 254, 205, 28, 118, 216, 58, 203,
+	236, 173, 196, 93, 7, 136, 162, 211, 69, 17, 172, 107, 83, 180, 120, 94, 37, 67, 181, 241, 44, 62, 104, 8, 245, 121, 153, 200, 4, 143, 107, 243,
+	194, 34, 63, 206, 120, 154, 192, 100, 167, 205, 151, 55, 91, 3, 148, 244, 26, 83, 7, 131, 27, 75, 241, 95, 48, 83, 141, 100, 157, 8, 167, 132,
+	16, 52, 121, 156, 249, 181, 30, 238, 90, 196, 219, 35, 132, 26, 222, 156, 198, 117, 141, 82, 197, 160, 233, 143, 175, 28, 94, 70, 234, 175, 61, 13,
+	128, 101, 248, 177, 46, 240, 212, 56, 17, 45, 106, 247, 169, 207, 70, 109, 170, 216, 64, 228, 156, 184, 113, 218, 189, 13, 231, 44, 186, 242, 76, 109,
+	189, 85, 218, 41, 71, 103, 54, 122, 24, 139, 55, 158, 243, 190, 52, 77, 11, 231, 32, 219, 14, 125, 33, 83, 52, 226, 130, 162, 45, 119, 215, 160,
+	49, 151, 18, 76, 109, 1, 70, 143, 236, 127, 218, 20, 123, 35, 234, 134, 46, 187, 122, 99, 41, 210, 3, 61, 148, 116, 214, 65, 127, 25, 212, 38,
+	253, 139, 24, 198, 130, 232, 203, 159, 184, 98, 229, 73, 6, 92, 146, 255, 177, 101, 59, 151, 96, 180, 203, 114, 211, 183, 20, 250, 193, 97, 30, 235,
+	83, 226, 197, 135, 221, 183, 118, 170, 86, 189, 71, 179, 82, 151, 189, 18, 93, 241, 14, 147, 251, 79, 133, 167, 245, 32, 173, 96, 202, 150, 90, 173,
+	63, 158, 229, 99, 13, 147, 79, 4, 253, 42, 200, 110, 170, 210, 118, 41, 132, 204, 170, 238, 40, 63, 251, 2, 146, 103, 61, 85, 10, 140, 68, 183,
+	5, 114, 165, 27, 91, 42, 244, 29, 214, 9, 157, 43, 228, 97, 58, 214, 155, 72, 201, 54, 174, 32, 198, 101, 51, 84, 144, 5, 248, 52, 117, 234,
+	21, 111, 47, 167, 187, 38, 212, 114, 66, 152, 22, 129, 236, 30, 65, 220, 24, 82, 6, 112, 213, 129, 164, 77, 43, 239, 170, 221, 154, 202, 244, 124,
+	208, 65, 46, 249, 142, 200, 156, 99, 53, 116, 245, 134, 194, 6, 255, 118, 177, 28, 132, 224, 88, 119, 233, 15, 209, 182, 234, 121, 78, 180, 13, 200,
+	135, 215, 81, 247, 62, 96, 234, 171, 135, 223, 178, 52, 83, 156, 191, 97, 164, 242, 146, 72, 187, 20, 100, 230, 195, 131, 27, 118, 45, 104, 25, 169,
+	138, 230, 103, 175, 74, 8, 64, 225, 139, 202, 68, 24, 107, 170, 140, 40, 86, 235, 106, 159, 8, 188, 67, 154, 128, 22, 61, 197, 37, 225, 162, 98,
+	68, 184, 1, 120, 140, 194, 19, 48, 87, 12, 104, 248, 203, 13, 136, 229, 46, 122, 194, 34, 246, 157, 50, 180, 15, 92, 214, 75, 182, 227, 57, 90,
+	37, 182, 13, 215, 126, 237, 113, 181, 19, 172, 92, 210, 53, 224, 69, 202, 11, 184, 64, 44, 211, 140, 36, 254, 86, 222, 104, 158, 131, 86, 49, 250,
+	28, 151, 227, 201, 25, 161, 109, 245, 206, 188, 67, 142, 38, 114, 181, 76, 10, 209, 56, 101, 134, 85, 221, 115, 146, 58, 161, 241, 6, 128, 158, 255,
+	198, 122, 84, 157, 50, 189, 33, 87, 249, 45, 149, 238, 119, 26, 163, 95, 222, 115, 250, 171, 93, 229, 107, 178, 55, 168, 33, 246, 9, 214, 147, 118,
+	177, 44, 102, 57, 87, 221, 71, 149, 125, 34, 159, 228, 87, 213, 54, 249, 107, 158, 236, 174, 5, 204, 32, 71, 253, 207, 32, 138, 95, 210, 73, 17,
+	145, 63, 236, 27, 101, 147, 220, 163, 70, 125, 2, 177, 78, 143, 247, 127, 53, 151, 17, 129, 25, 71, 200, 1, 117, 206, 141, 75, 174, 101, 20, 201,
+	81, 239, 128, 169, 255, 40, 186, 8, 58, 237, 112, 4, 167, 128, 25, 172, 137, 85, 23, 68, 228, 153, 125, 167, 10, 102, 178, 65, 190, 43, 171, 98,
+	213, 41, 168, 201, 252, 61, 15, 132, 203, 225, 102, 193, 40, 207, 8, 176, 33, 198, 79, 190, 242, 153, 45, 137, 241, 20, 93, 220, 58, 187, 235, 62,
+	141, 7, 209, 29, 143, 118, 208, 100, 174, 211, 82, 198, 63, 241, 98, 218, 35, 206, 121, 189, 105, 49, 83, 223, 192, 48, 123, 246, 19, 225, 117, 241,
+	184, 89, 114, 8, 135, 86, 192, 108, 53, 24, 160, 63, 233, 111, 87, 66, 215, 103, 227, 57, 110, 173, 88, 221, 68, 162, 192, 43, 120, 152, 35, 113,
+	223, 185, 93, 67, 180, 16, 75, 243, 135, 21, 48, 137, 182, 16, 150, 72, 183, 54, 254, 142, 17, 244, 182, 27, 136, 230, 74, 163, 103, 149, 58, 2,
+	32, 142, 224, 72, 180, 229, 42, 242, 176, 84, 254, 136, 19, 156, 187, 242, 133, 161, 7, 143, 32, 215, 16, 183, 105, 32, 129, 229, 4, 253, 79, 167,
+	21, 53, 155, 235, 106, 224, 164, 35, 91, 155, 252, 106, 222, 43, 118, 237, 5, 157, 80, 36, 210, 159, 64, 111, 87, 153, 7, 216, 35, 204, 81, 127,
+	250, 194, 52, 164, 30, 119, 156, 6, 141, 208, 34, 96, 218, 48, 122, 15, 43, 89, 254, 182, 77, 130, 238, 52, 149, 248, 81, 171, 97, 200, 129, 211,
+	102, 248, 124, 39, 205, 55, 125, 197, 64, 216, 176, 29, 84, 159, 193, 91, 133, 224, 112, 178, 90, 123, 1, 206, 242, 39, 194, 90, 135, 179, 228, 166,
+	67, 15, 106, 244, 205, 92, 61, 222, 105, 67, 124, 171, 197, 81, 232, 170, 196, 61, 121, 205, 47, 166, 93, 120, 202, 11, 213, 57, 142, 19, 65, 41,
+	188, 74, 173, 20, 90, 153, 12, 232, 111, 2, 126, 67, 205, 247, 55, 28, 211, 62, 15, 240, 47, 225, 188, 141, 55, 175, 120, 254, 62, 13, 42, 94,
+	201, 160, 135, 79, 10, 132, 197, 163, 21, 191, 231, 7, 60, 145, 27, 99, 148, 219, 19, 99, 233, 4, 192, 37, 66, 161, 114, 36, 193, 238, 159, 224,
+	145, 2, 214, 136, 192, 252, 76, 145, 188, 52, 238, 147, 99, 11, 141, 174, 107, 163, 199, 130, 153, 75, 25, 98, 214, 81, 17, 165, 110, 237, 150, 120,
+};
+
+void OrderedDither::Row(DitherMode mode, int x, int y, const UBYTE * tone, UBYTE * black, int count) {
+	const UBYTE * thresholds;
+	int mask;
+	if(mode == DitherBayer) {
+		thresholds = BayerThresholds + (y % BayerSize) * BayerSize;
+		mask = BayerSize - 1;
+	} else {
+		thresholds = BlueNoiseThresholds + (y % BlueNoiseSize) * BlueNoiseSize;
+		mask = BlueNoiseSize - 1;
+	}
+	for(int k = 0; k < count; ++k) {
+		black[k] = tone[k] < thresholds[(x + k) & mask];
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef _ORDERED_DITHER_HPP_
+#define _ORDERED_DITHER_HPP_
+
+#include "DEV_Config.h"
+#include "error_diffusion.hpp"
+
+/**
+ * Ordered dithering against threshold tiles built into the binary: an 8x8
+ * Bayer matrix for DitherBayer and a 64x64 blue-noise mask for
+ * DitherBlueNoise, both repeated across the frame. Thresholds run evenly
+ * over 1..255, so tone 0 is all black and tone 255 all white.
+ *
+ * Every pixel is decided on its own, so tiles dither themselves as they are
+ * rendered, in parallel and with no pass over the frame afterwards.
+**/
+class OrderedDither {
+	public: static constexpr int BayerSize = 8;
+	static constexpr int BlueNoiseSize = 64;
+	/**
+	 * Dithers count pixels of row y starting at x: black[k] is set to 1 when
+	 * tone[k] (0 black .. 255 white) lies below the threshold at (x + k, y).
+	**/
+	static void Row(DitherMode mode, int x, int y, const UBYTE * tone, UBYTE * black, int count);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "packed_frame.hpp"
+#include "GUI_Paint.h"
+#include <cstring>
+
+void PackedFrame::Bind(int width, int height, bool gray, bool dithered) {
+	this->width = width;
+	this->height = height;
+	widthByte = (width + 7) / 8;
+	bool fitsPaint = Paint.Image && Paint.Scale == 2 && Paint.Rotate == ROTATE_0 && Paint.Mirror == MIRROR_NONE && Paint.WidthByte == widthByte && Paint.HeightMemory >= height;
+	// The dithered plane takes the Paint image when there is one.
+	direct = fitsPaint && !dithered;
+	if(direct) {
+		target = Paint.Image;
+	} else {
+		buffer.assign(widthByte * height, 0xFF);
+		target = buffer.data();
+	}
+	this->dithered = dithered;
+	ditherDirect = fitsPaint && dithered;
+	if(ditherDirect) {
+		ditherTarget = Paint.Image;
+	} else if(dithered) {
+		ditherBuffer.assign(widthByte * height, 0xFF);
+		ditherTarget = ditherBuffer.data();
+	}
+	this->gray = gray;
+	if(!gray) {
+		return;
+	}
+	grayWidthByte = (width + 3) / 4;
+	grayDirect = Paint.Image && Paint.Scale == 4 && Paint.Rotate == ROTATE_0 && Paint.Mirror == MIRROR_NONE && Paint.WidthByte == grayWidthByte && Paint.HeightMemory >= height;
+	if(grayDirect) {
+		grayTarget = Paint.Image;
+	} else {
+		grayBuffer.assign(grayWidthByte * height, 0xFF);
+		grayTarget = grayBuffer.data();
+	}
+}
+
+int PackedFrame::StoreRow(int x, int y, const UBYTE * black, int count) {
+	UBYTE bytes[64];
+	int byteCount = (count + 7) / 8;
+	int blackCount = 0;
+	for(int b = 0; b < byteCount; ++b) {
+		int bits = count - b * 8 < 8 ? count - b * 8 : 8;
+		UBYTE packed = 0;
+		for(int k = 0; k < bits; ++k) {
+			packed |= black[b * 8 + k] << (7 - k);
+		}
+		blackCount += __builtin_popcount(packed);
+		// Padding bits past the last pixel stay white.
+		bytes[b] = (UBYTE) ~packed;
+	}
+	memcpy(target + y * widthByte + x / 8, bytes, byteCount);
+	return blackCount;
+}
+
+void PackedFrame::StoreGrayRow(int x, int y, const UBYTE * levels, int count) {
+	UBYTE bytes[128];
+	int byteCount = (count + 3) / 4;
+	for(int b = 0; b < byteCount; ++b) {
+		int pixels = count - b * 4 < 4 ? count - b * 4 : 4;
+		// Padding pixels past the last one stay white.
+		UBYTE packed = 0xFF;
+		for(int k = 0; k < pixels; ++k) {
+			packed ^= (UBYTE)((3 ^ levels[b * 4 + k]) << (6 - 2 * k));
+		}
+		bytes[b] = packed;
+	}
+	memcpy(grayTarget + y * grayWidthByte + x / 4, bytes, byteCount);
+}
+
+void PackedFrame::StoreDitheredRow(int x, int y, const UBYTE * black, int count) {
+	UBYTE * row = ditherTarget + y * widthByte + x / 8;
+	int byteCount = (count + 7) / 8;
+	for(int b = 0; b < byteCount; ++b) {
+		int bits = count - b * 8 < 8 ? count - b * 8 : 8;
+		UBYTE packed = 0;
+		for(int k = 0; k < bits; ++k) {
+			packed |= black[b * 8 + k] << (7 - k);
+		}
+		row[b] = (UBYTE) ~packed;
+	}
+}
+
+void PackedFrame::Publish() const {
+	if(gray && Paint.Scale == 4) {
+		if(!grayDirect) {
+			for(int y = 0; y < height; ++y) {
+				for(int x = 0; x < width; ++x) {
+					Paint_SetPixel(x, y, Level(x, y));
+				}
+			}
+		}
+		return;
+	}
+	if(dithered ? ditherDirect : direct) {
+		return;
+	}
+	const UBYTE * plane = dithered ? ditherTarget : target;
+	if(Paint.Scale != 2) {
+		for(int y = 0; y < height; ++y) {
+			for(int x = 0; x < width; ++x) {
+				bool black = !(plane[y * widthByte + x / 8] & (0x80 >> (x % 8)));
+				Paint_SetPixel(x, y, black ? BLACK : WHITE);
+			}
+		}
+		return;
+	}
+	// Paint_SetPixel's mapping, resolved once: physical X = ax + bx * x + cx * y
+	// and likewise for Y.
+	int ax = 0, bx = 1, cx = 0, ay = 0, by = 0, cy = 1;
+	int wm = Paint.WidthMemory, hm = Paint.HeightMemory;
+	switch(Paint.Rotate) {
+		case ROTATE_90:
+			ax = wm - 1; bx = 0; cx = -1; ay = 0; by = 1; cy = 0;
+			break;
+		case ROTATE_180:
+			ax = wm - 1; bx = -1; cx = 0; ay = hm - 1; by = 0; cy = -1;
+			break;
+		case ROTATE_270:
+			ax = 0; bx = 0; cx = 1; ay = hm - 1; by = -1; cy = 0;
+			break;
+	}
+	if(Paint.Mirror == MIRROR_HORIZONTAL || Paint.Mirror == MIRROR_ORIGIN) {
+		ax = wm - 1 - ax; bx = -bx; cx = -cx;
+	}
+	if(Paint.Mirror == MIRROR_VERTICAL || Paint.Mirror == MIRROR_ORIGIN) {
+		ay = hm - 1 - ay; by = -by; cy = -cy;
+	}
+	for(int y = 0; y < height; ++y) {
+		const UBYTE * row = plane + y * widthByte;
+		int X = ax + cx * y;
+		int Y = ay + cy * y;
+		for(int x = 0; x < width; ++x, X += bx, Y += by) {
+			if(X < 0 || Y < 0 || X >= wm || Y >= hm) {
+				continue;
+			}
+			UBYTE bit = 0x80 >> (X & 7);
+			UBYTE & byte = Paint.Image[(X >> 3) + Y * Paint.WidthByte];
+			byte = (row[x >> 3] << (x & 7) & 0x80) ? byte | bit : byte & ~bit;
+		}
+	}
+}
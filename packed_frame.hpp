@@ -0,0 +1,95 @@
+#ifndef _PACKED_FRAME_HPP_
+#define _PACKED_FRAME_HPP_
+
+#include "DEV_Config.h"
+#include <vector>
+
+/**
+ * 1bpp frame in logical (unrotated) orientation with the Paint bit layout:
+ * rows of WidthByte bytes, most significant bit first, 1 = white.
+ * A frame bound with gray levels also has a 2bpp plane in the layout of
+ * Paint scale 4 and the 4-gray drivers: four pixels per byte, most
+ * significant first, 3 = white, 2 and 1 the lighter and darker gray,
+ * 0 = black.
+ * A frame bound for dithering keeps a second 1bpp plane with the dithered
+ * image, which is the one published; the first plane still holds the set
+ * itself, for the frame statistics and the zoom search.
+ *
+ * Workers store whole bytes of a row straight into it, so there is no
+ * per-pixel rotation switch and no read-modify-write of a byte another
+ * thread may be writing. When the selected Paint image is unrotated and
+ * unmirrored the frame writes into it directly; otherwise it renders into
+ * its own buffer and Publish() maps that into the Paint image once per frame.
+**/
+class PackedFrame {
+	public:
+	/**
+	 * Targets the currently selected Paint image for a width x height frame,
+	 * with the 2bpp plane as well when gray is set and the dithered plane
+	 * when dithered is.
+	**/
+	void Bind(int width, int height, bool gray = false, bool dithered = false);
+	/**
+	 * Packs count (at most 512) pixels of row y starting at x (a multiple of 8) from
+	 * black[k] in {0, 1} and returns how many of them are black. Calls for
+	 * disjoint byte ranges may run concurrently.
+	**/
+	int StoreRow(int x, int y, const UBYTE * black, int count);
+	/**
+	 * Packs count (at most 512) gray levels in 0..3 of row y starting at x (a
+	 * multiple of 4) into the 2bpp plane, with StoreRow's concurrency rules.
+	**/
+	void StoreGrayRow(int x, int y, const UBYTE * levels, int count);
+	/**
+	 * Packs count pixels of row y of the dithered plane starting at x (a
+	 * multiple of 8) from black[k] in {0, 1}, with StoreRow's concurrency
+	 * rules.
+	**/
+	void StoreDitheredRow(int x, int y, const UBYTE * black, int count);
+	/**
+	 * Copies the frame into the Paint image when it was not written in place:
+	 * the 2bpp plane into a scale 4 image, otherwise the dithered plane if
+	 * there is one and the 1bpp plane if not.
+	**/
+	void Publish() const;
+	bool IsBlack(int x, int y) const {
+		return !(target[y * widthByte + x / 8] & (0x80 >> (x % 8)));
+	};
+	const UBYTE * Row(int y) const {
+		return target + y * widthByte;
+	};
+	int WidthByte() const {
+		return widthByte;
+	};
+	bool HasGray() const {
+		return gray;
+	};
+	UBYTE Level(int x, int y) const {
+		return grayTarget[y * grayWidthByte + x / 4] >> (6 - 2 * (x % 4)) & 3;
+	};
+	/**
+	 * Rewrites one gray level; calls for different rows may run concurrently.
+	**/
+	void SetLevel(int x, int y, UBYTE level) {
+		UBYTE & byte = grayTarget[y * grayWidthByte + x / 4];
+		int shift = 6 - 2 * (x % 4);
+		byte = (UBYTE)((byte & ~(3 << shift)) | level << shift);
+	};
+	private: int width = 0;
+	int height = 0;
+	int widthByte = 0;
+	bool direct = false;
+	UBYTE * target = nullptr;
+	std::vector < UBYTE > buffer;
+	bool gray = false;
+	int grayWidthByte = 0;
+	bool grayDirect = false;
+	UBYTE * grayTarget = nullptr;
+	std::vector < UBYTE > grayBuffer;
+	bool dithered = false;
+	bool ditherDirect = false;
+	UBYTE * ditherTarget = nullptr;
+	std::vector < UBYTE > ditherBuffer;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "perturbation.hpp"
+#include "escape_kernel.hpp"
+#include <cmath>
+
+// Relative size of the cubic term at which the series stops being trusted,
+// and the relative error allowed at the probe points (about what the double
+// iteration itself loses over a few thousand steps).
+static constexpr double SeriesTermTolerance = 1e-3;
+static constexpr double SeriesProbeTolerance = 1e-12;
+
+void PerturbationOrbit::Compute(const HighPrecision & centerX, const HighPrecision & centerY, double pixelSize, double radius, int iterations) {
+	this->iterations = iterations;
+	int fractionLimbs = HighPrecision::LimbsForScale(pixelSize);
+	HighPrecision cx = centerX;
+	HighPrecision cy = centerY;
+	cx.SetFractionLimbs(fractionLimbs);
+	cy.SetFractionLimbs(fractionLimbs);
+	HighPrecision zx(0.0, fractionLimbs);
+	HighPrecision zy(0.0, fractionLimbs);
+	referenceX.assign(1, 0.0);
+	referenceY.assign(1, 0.0);
+	// Z_0 = 0, so Z_1 = C is the kernel's starting point and Z_{n + 2} its n-th iterate.
+	for(int n = 0; n <= iterations; ++n) {
+		HighPrecision xx = zx * zx;
+		HighPrecision yy = zy * zy;
+		HighPrecision xy = zx * zy;
+		zx = xx - yy + cx;
+		zy = xy + xy + cy;
+		double x = zx.ToDouble();
+		double y = zy.ToDouble();
+		referenceX.push_back(x);
+		referenceY.push_back(y);
+		if(x * x + y * y > 4.0) {
+			break;
+		}
+	}
+	FitSeries(radius);
+}
+
+void PerturbationOrbit::FitSeries(double radius) {
+	typedef std::complex < double > Complex;
+	seriesRadius = radius;
+	int length = ReferenceLength();
+	seriesA.assign(length, Complex());
+	seriesB.assign(length, Complex());
+	seriesC.assign(length, Complex());
+	seriesSkip = 0;
+	if(length < 2) {
+		return;
+	}
+	// d_1 = dc exactly: a_1 = radius, b_1 = c_1 = 0.
+	seriesA[1] = radius;
+	int candidate = 1;
+	for(int n = 1; n + 1 < length; ++n) {
+		Complex z(referenceX[n], referenceY[n]);
+		Complex a = seriesA[n], b = seriesB[n], c = seriesC[n];
+		seriesA[n + 1] = 2.0 * z * a + radius;
+		seriesB[n + 1] = 2.0 * z * b + a * a;
+		seriesC[n + 1] = 2.0 * z * c + 2.0 * a * b;
+		double bound = std::abs(seriesA[n + 1]) + std::abs(seriesB[n + 1]) + std::abs(seriesC[n + 1]);
+		// Stop while every pixel is certainly still inside |z| <= 2, so no
+		// escape is skipped over, and while the cubic term is negligible.
+		if(std::abs(Complex(referenceX[n + 1], referenceY[n + 1])) + bound > 2.0 || std::abs(seriesC[n + 1]) > SeriesTermTolerance * std::abs(seriesA[n + 1])) {
+			break;
+		}
+		candidate = n + 1;
+	}
+	const Complex probes[] = {
+		Complex(radius, 0.0), Complex(-radius, 0.0), Complex(0.0, radius), Complex(0.0, -radius),
+		std::polar(radius, M_PI / 4), std::polar(radius, 3 * M_PI / 4), std::polar(radius, -M_PI / 4), std::polar(radius, -3 * M_PI / 4),
+	};
+	while(candidate > 1) {
+		bool holds = true;
+		for(const Complex & probe: probes) {
+			holds = holds && SeriesHolds(candidate, probe);
+		}
+		if(holds) {
+			break;
+		}
+		candidate /= 2;
+	}
+	seriesSkip = candidate;
+}
+
+std::complex < double > PerturbationOrbit::SeriesDelta(int skip, std::complex < double > dc) const {
+	std::complex < double > u = dc / seriesRadius;
+	return ((seriesC[skip] * u + seriesB[skip]) * u + seriesA[skip]) * u;
+}
+
+std::complex < double > PerturbationOrbit::SeriesDerivative(int skip, std::complex < double > dc) const {
+	std::complex < double > u = dc / seriesRadius;
+	return ((3.0 * seriesC[skip] * u + 2.0 * seriesB[skip]) * u + seriesA[skip]) / seriesRadius;
+}
+
+bool PerturbationOrbit::SeriesHolds(int skip, std::complex < double > dc) const {
+	std::complex < double > d = 0.0;
+	for(int n = 0; n < skip; ++n) {
+		std::complex < double > z(referenceX[n], referenceY[n]);
+		d = (2.0 * z + d) * d + dc;
+	}
+	return std::abs(SeriesDelta(skip, dc) - d) <= SeriesProbeTolerance * std::abs(d);
+}
+
+template < bool Distance >
+int PerturbationOrbit::Escape(double dcx, double dcy, PerturbationStats & stats, double & escapeR2, double distanceThreshold) const {
+	const int length = ReferenceLength();
+	const int lastIndex = iterations + 1;
+	int n = seriesSkip;
+	int m = seriesSkip;
+	double dx = 0.0, dy = 0.0;
+	// dz/dc of Z + d; Z_0 = 0 does not depend on c.
+	double dzx = 0.0, dzy = 0.0;
+	if(seriesSkip > 0) {
+		std::complex < double > d = SeriesDelta(seriesSkip, std::complex < double > (dcx, dcy));
+		dx = d.real();
+		dy = d.imag();
+		if(Distance) {
+			std::complex < double > dz = SeriesDerivative(seriesSkip, std::complex < double > (dcx, dcy));
+			dzx = dz.real();
+			dzy = dz.imag();
+		}
+		stats.iterationsSkipped += seriesSkip;
+	}
+	while(n < lastIndex) {
+		double zx = referenceX[m], zy = referenceY[m];
+		if(Distance) {
+			double fx = zx + dx, fy = zy + dy;
+			double dzx_old = dzx;
+			dzx = 2.0 * (fx * dzx - fy * dzy) + 1.0;
+			dzy = 2.0 * (fx * dzy + fy * dzx_old);
+		}
+		double nx = (2.0 * zx + dx) * dx - (2.0 * zy + dy) * dy + dcx;
+		double ny = (2.0 * zx + dx) * dy + (2.0 * zy + dy) * dx + dcy;
+		++m;
+		++n;
+		double fx = referenceX[m] + nx;
+		double fy = referenceY[m] + ny;
+		double magnitude = fx * fx + fy * fy;
+		if(n >= 2 && magnitude > 4.0) {
+			// Z_1 is the centre, so c is Z_1 + dc.
+			if(Distance && EscapeKernel::WithinDistance(referenceX[1] + dcx, referenceY[1] + dcy, fx, fy, dzx, dzy, distanceThreshold)) {
+				escapeR2 = 4.0;
+				return iterations;
+			}
+			escapeR2 = magnitude;
+			return n - 2;
+		}
+		if(magnitude < nx * nx + ny * ny || m == length - 1) {
+			dx = fx;
+			dy = fy;
+			m = 0;
+			stats.rebases++;
+		} else {
+			dx = nx;
+			dy = ny;
+		}
+	}
+	escapeR2 = 4.0;
+	return iterations;
+}
+
+void PerturbationOrbit::Run(const double * dcx, const double * dcy, int count, int * escapeIter, PerturbationStats * stats, double * escapeR2, double distanceThreshold) const {
+	PerturbationStats local;
+	double radius2;
+	for(int k = 0; k < count; ++k) {
+		escapeIter[k] = distanceThreshold > 0.0 ? Escape < true > (dcx[k], dcy[k], local, radius2, distanceThreshold) : Escape < false > (dcx[k], dcy[k], local, radius2, 0.0);
+		if(escapeR2) {
+			escapeR2[k] = radius2;
+		}
+	}
+	if(stats) {
+		stats->Add(local);
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef _PERTURBATION_HPP_
+#define _PERTURBATION_HPP_
+
+#include "high_precision.hpp"
+#include <complex>
+#include <vector>
+
+/**
+ * Per-thread counters of the perturbation kernel, merged per frame.
+**/
+struct PerturbationStats {
+	unsigned long long rebases = 0;
+	unsigned long long iterationsSkipped = 0;
+	void Add(const PerturbationStats & other) {
+		rebases += other.rebases;
+		iterationsSkipped += other.iterationsSkipped;
+	}
+};
+
+/**
+ * Deep-zoom engine: one reference orbit Z is iterated in HighPrecision at the
+ * view centre, and every pixel c = C + dc follows only its difference
+ *   d' = 2 Z d + d^2 + dc
+ * in doubles. Two standard refinements keep that exact and cheap:
+ *   - Rebasing (glitch correction): when |Z + d| < |d| the pixel has come
+ *     closer to 0 than to the reference, where d loses its relative precision;
+ *     the pixel restarts from the beginning of the orbit with d = Z + d.
+ *     The same happens when the reference itself escapes.
+ *   - Series approximation: d after the first N iterations is a cubic in dc
+ *     that holds for the whole frame, so those iterations are skipped. N is
+ *     chosen from the coefficients and then checked against directly
+ *     iterated probe points at the frame corners.
+ *
+ * Iteration counts match EscapeKernel::Run: z starts at c and the value
+ * returned is the number of further iterations before |z| > 2.
+**/
+class PerturbationOrbit {
+	public:
+	/**
+	 * Iterates the reference orbit at (centerX, centerY) to enough bits for
+	 * steps of pixelSize, then fits the series for offsets up to radius.
+	**/
+	void Compute(const HighPrecision & centerX, const HighPrecision & centerY, double pixelSize, double radius, int iterations);
+	/**
+	 * Same contract as EscapeKernel::Run, with (dcx, dcy) the pixel offsets
+	 * from the centre passed to Compute. dz/dc for the distance estimate is
+	 * that of the full orbit Z + d, and starts from the derivative of the
+	 * series when iterations are skipped.
+	**/
+	void Run(const double * dcx, const double * dcy, int count, int * escapeIter, PerturbationStats * stats = nullptr, double * escapeR2 = nullptr, double distanceThreshold = 0.0) const;
+	int Iterations() const {
+		return iterations;
+	};
+	int ReferenceLength() const {
+		return (int) referenceX.size();
+	};
+	int SkippedIterations() const {
+		return seriesSkip;
+	};
+	private: template < bool Distance > int Escape(double dcx, double dcy, PerturbationStats & stats, double & escapeR2, double distanceThreshold) const;
+	std::complex < double > SeriesDelta(int skip, std::complex < double > dc) const;
+	std::complex < double > SeriesDerivative(int skip, std::complex < double > dc) const;
+	bool SeriesHolds(int skip, std::complex < double > dc) const;
+	void FitSeries(double radius);
+	int iterations = 0;
+	double seriesRadius = 1.0;
+	int seriesSkip = 0;
+	std::vector < double > referenceX;
+	std::vector < double > referenceY;
+	/**
+	 * Series coefficients scaled by powers of the radius, so that
+	 * d_n = a_n u + b_n u^2 + c_n u^3 with u = dc / radius stays in range even
+	 * where the unscaled derivative would overflow a double.
+	**/
+	std::vector < std::complex < double >> seriesA;
+	std::vector < std::complex < double >> seriesB;
+	std::vector < std::complex < double >> seriesC;
+};
+
+#endif
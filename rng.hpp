@@ -0,0 +1,77 @@
+#ifndef _RNG_HPP_
+#define _RNG_HPP_
+
+#include <cstdint>
+
+/**
+ * Seedable random number generator for every exploration decision, so that a
+ * run started from the same seed makes the same choices and renders the same
+ * frames.
+ *
+ * xoshiro256** (Blackman and Vigna): 32 bytes of state, a handful of integer
+ * operations per draw, and a state that can be saved and restored exactly.
+ * Stream(seed, n) derives independent generators from one seed through
+ * SplitMix64, e.g. one per thread or per purpose, without the streams
+ * depending on how many numbers the others have drawn.
+**/
+class Rng {
+	public: explicit Rng(uint64_t seed = 0) {
+		Seed(seed, 0);
+	};
+	static Rng Stream(uint64_t seed, uint64_t stream) {
+		Rng rng;
+		rng.Seed(seed, stream);
+		return rng;
+	};
+	void Seed(uint64_t seed, uint64_t stream = 0) {
+		uint64_t mix = seed ^ stream * 0xD1B54A32D192ED03ull;
+		for(int k = 0; k < 4; ++k) {
+			state[k] = SplitMix64(mix);
+		}
+	};
+	uint64_t Next() {
+		uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+		uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = RotateLeft(state[3], 45);
+		return result;
+	};
+	/**
+	 * Uniform in [0, 1).
+	**/
+	double Uniform() {
+		return (Next() >> 11) * 0x1.0p-53;
+	};
+	/**
+	 * Uniform in [0, n) for n > 0.
+	**/
+	int Below(int n) {
+		return (int)(((Next() >> 32) * (uint64_t) n) >> 32);
+	};
+	void GetState(uint64_t out[4]) const {
+		for(int k = 0; k < 4; ++k) {
+			out[k] = state[k];
+		}
+	};
+	void SetState(const uint64_t in[4]) {
+		for(int k = 0; k < 4; ++k) {
+			state[k] = in[k];
+		}
+	};
+	private: static uint64_t RotateLeft(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	};
+	static uint64_t SplitMix64(uint64_t & x) {
+		uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	};
+	uint64_t state[4];
+};
+
+#endif
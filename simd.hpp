@@ -0,0 +1,216 @@
+#ifndef _SIMD_HPP_
+#define _SIMD_HPP_
+
+/**
+ * Thin wrappers over the double-precision vector registers of each target.
+ * Only the operations the escape kernels need are provided, and every one of
+ * them maps to a single IEEE instruction (no fused multiply-add), so a kernel
+ * written against VecD rounds exactly like the equivalent scalar code.
+ * VecI holds 32-bit integers in the same registers, for the fixed-point
+ * dither kernels; it has no multiply, which SSE2 lacks for 32-bit lanes.
+ *
+ * The backend is chosen at compile time:
+ *   AVX2  (x86, -mavx2)      4 lanes, 8 for VecI
+ *   SSE2  (any x86_64)       2 lanes, 4 for VecI
+ *   NEON  (aarch64, Pi 4/5)  2 lanes, 4 for VecI
+ *   scalar fallback          1 lane
+**/
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_BACKEND "avx2"
+
+struct VecD {
+	static constexpr int Lanes = 4;
+	__m256d v;
+	VecD() {}
+	VecD(__m256d value): v(value) {}
+	static VecD Broadcast(double value) { return _mm256_set1_pd(value); }
+	static VecD Load(const double * ptr) { return _mm256_loadu_pd(ptr); }
+	void Store(double * ptr) const { _mm256_storeu_pd(ptr, v); }
+};
+struct MaskD {
+	__m256d m;
+	MaskD() {}
+	MaskD(__m256d value): m(value) {}
+	static MaskD All() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+	static MaskD None() { return _mm256_setzero_pd(); }
+};
+static inline VecD operator + (VecD a, VecD b) { return _mm256_add_pd(a.v, b.v); }
+static inline VecD operator - (VecD a, VecD b) { return _mm256_sub_pd(a.v, b.v); }
+static inline VecD operator * (VecD a, VecD b) { return _mm256_mul_pd(a.v, b.v); }
+static inline VecD Abs(VecD a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+static inline MaskD operator > (VecD a, VecD b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+static inline MaskD operator < (VecD a, VecD b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+static inline MaskD operator & (MaskD a, MaskD b) { return _mm256_and_pd(a.m, b.m); }
+static inline MaskD operator | (MaskD a, MaskD b) { return _mm256_or_pd(a.m, b.m); }
+static inline MaskD AndNot(MaskD a, MaskD b) { return _mm256_andnot_pd(b.m, a.m); }
+static inline VecD Select(MaskD mask, VecD a, VecD b) { return _mm256_blendv_pd(b.v, a.v, mask.m); }
+static inline VecD MaskedAdd(VecD a, MaskD mask, VecD b) { return _mm256_add_pd(a.v, _mm256_and_pd(mask.m, b.v)); }
+static inline bool Any(MaskD mask) { return _mm256_movemask_pd(mask.m) != 0; }
+static inline int Bits(MaskD mask) { return _mm256_movemask_pd(mask.m); }
+
+struct VecI {
+	static constexpr int Lanes = 8;
+	__m256i v;
+	VecI() {}
+	VecI(__m256i value): v(value) {}
+	static VecI Broadcast(int32_t value) { return _mm256_set1_epi32(value); }
+	static VecI Load(const int32_t * ptr) { return _mm256_loadu_si256((const __m256i *) ptr); }
+	void Store(int32_t * ptr) const { _mm256_storeu_si256((__m256i *) ptr, v); }
+};
+static inline VecI operator + (VecI a, VecI b) { return _mm256_add_epi32(a.v, b.v); }
+static inline VecI operator - (VecI a, VecI b) { return _mm256_sub_epi32(a.v, b.v); }
+template < int Bits > static inline VecI ShiftLeft(VecI a) { return _mm256_slli_epi32(a.v, Bits); }
+template < int Bits > static inline VecI ShiftRight(VecI a) { return _mm256_srai_epi32(a.v, Bits); }
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_BACKEND "sse2"
+
+struct VecD {
+	static constexpr int Lanes = 2;
+	__m128d v;
+	VecD() {}
+	VecD(__m128d value): v(value) {}
+	static VecD Broadcast(double value) { return _mm_set1_pd(value); }
+	static VecD Load(const double * ptr) { return _mm_loadu_pd(ptr); }
+	void Store(double * ptr) const { _mm_storeu_pd(ptr, v); }
+};
+struct MaskD {
+	__m128d m;
+	MaskD() {}
+	MaskD(__m128d value): m(value) {}
+	static MaskD All() { return _mm_castsi128_pd(_mm_set1_epi32(-1)); }
+	static MaskD None() { return _mm_setzero_pd(); }
+};
+static inline VecD operator + (VecD a, VecD b) { return _mm_add_pd(a.v, b.v); }
+static inline VecD operator - (VecD a, VecD b) { return _mm_sub_pd(a.v, b.v); }
+static inline VecD operator * (VecD a, VecD b) { return _mm_mul_pd(a.v, b.v); }
+static inline VecD Abs(VecD a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+static inline MaskD operator > (VecD a, VecD b) { return _mm_cmpgt_pd(a.v, b.v); }
+static inline MaskD operator < (VecD a, VecD b) { return _mm_cmplt_pd(a.v, b.v); }
+static inline MaskD operator & (MaskD a, MaskD b) { return _mm_and_pd(a.m, b.m); }
+static inline MaskD operator | (MaskD a, MaskD b) { return _mm_or_pd(a.m, b.m); }
+static inline MaskD AndNot(MaskD a, MaskD b) { return _mm_andnot_pd(b.m, a.m); }
+static inline VecD Select(MaskD mask, VecD a, VecD b) { return _mm_or_pd(_mm_and_pd(mask.m, a.v), _mm_andnot_pd(mask.m, b.v)); }
+static inline VecD MaskedAdd(VecD a, MaskD mask, VecD b) { return _mm_add_pd(a.v, _mm_and_pd(mask.m, b.v)); }
+static inline bool Any(MaskD mask) { return _mm_movemask_pd(mask.m) != 0; }
+static inline int Bits(MaskD mask) { return _mm_movemask_pd(mask.m); }
+
+struct VecI {
+	static constexpr int Lanes = 4;
+	__m128i v;
+	VecI() {}
+	VecI(__m128i value): v(value) {}
+	static VecI Broadcast(int32_t value) { return _mm_set1_epi32(value); }
+	static VecI Load(const int32_t * ptr) { return _mm_loadu_si128((const __m128i *) ptr); }
+	void Store(int32_t * ptr) const { _mm_storeu_si128((__m128i *) ptr, v); }
+};
+static inline VecI operator + (VecI a, VecI b) { return _mm_add_epi32(a.v, b.v); }
+static inline VecI operator - (VecI a, VecI b) { return _mm_sub_epi32(a.v, b.v); }
+template < int Bits > static inline VecI ShiftLeft(VecI a) { return _mm_slli_epi32(a.v, Bits); }
+template < int Bits > static inline VecI ShiftRight(VecI a) { return _mm_srai_epi32(a.v, Bits); }
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_BACKEND "neon"
+
+struct VecD {
+	static constexpr int Lanes = 2;
+	float64x2_t v;
+	VecD() {}
+	VecD(float64x2_t value): v(value) {}
+	static VecD Broadcast(double value) { return vdupq_n_f64(value); }
+	static VecD Load(const double * ptr) { return vld1q_f64(ptr); }
+	void Store(double * ptr) const { vst1q_f64(ptr, v); }
+};
+struct MaskD {
+	uint64x2_t m;
+	MaskD() {}
+	MaskD(uint64x2_t value): m(value) {}
+	static MaskD All() { return vdupq_n_u64(~0ULL); }
+	static MaskD None() { return vdupq_n_u64(0); }
+};
+static inline VecD operator + (VecD a, VecD b) { return vaddq_f64(a.v, b.v); }
+static inline VecD operator - (VecD a, VecD b) { return vsubq_f64(a.v, b.v); }
+static inline VecD operator * (VecD a, VecD b) { return vmulq_f64(a.v, b.v); }
+static inline VecD Abs(VecD a) { return vabsq_f64(a.v); }
+static inline MaskD operator > (VecD a, VecD b) { return vcgtq_f64(a.v, b.v); }
+static inline MaskD operator < (VecD a, VecD b) { return vcltq_f64(a.v, b.v); }
+static inline MaskD operator & (MaskD a, MaskD b) { return vandq_u64(a.m, b.m); }
+static inline MaskD operator | (MaskD a, MaskD b) { return vorrq_u64(a.m, b.m); }
+static inline MaskD AndNot(MaskD a, MaskD b) { return vbicq_u64(a.m, b.m); }
+static inline VecD Select(MaskD mask, VecD a, VecD b) { return vbslq_f64(mask.m, a.v, b.v); }
+static inline VecD MaskedAdd(VecD a, MaskD mask, VecD b) {
+	return vaddq_f64(a.v, vreinterpretq_f64_u64(vandq_u64(mask.m, vreinterpretq_u64_f64(b.v))));
+}
+static inline bool Any(MaskD mask) { return vmaxvq_u32(vreinterpretq_u32_u64(mask.m)) != 0; }
+static inline int Bits(MaskD mask) {
+	return (int) (vgetq_lane_u64(mask.m, 0) & 1) | (int) ((vgetq_lane_u64(mask.m, 1) & 1) << 1);
+}
+
+struct VecI {
+	static constexpr int Lanes = 4;
+	int32x4_t v;
+	VecI() {}
+	VecI(int32x4_t value): v(value) {}
+	static VecI Broadcast(int32_t value) { return vdupq_n_s32(value); }
+	static VecI Load(const int32_t * ptr) { return vld1q_s32(ptr); }
+	void Store(int32_t * ptr) const { vst1q_s32(ptr, v); }
+};
+static inline VecI operator + (VecI a, VecI b) { return vaddq_s32(a.v, b.v); }
+static inline VecI operator - (VecI a, VecI b) { return vsubq_s32(a.v, b.v); }
+template < int Bits > static inline VecI ShiftLeft(VecI a) { return vshlq_n_s32(a.v, Bits); }
+template < int Bits > static inline VecI ShiftRight(VecI a) { return vshrq_n_s32(a.v, Bits); }
+
+#else
+#define SIMD_BACKEND "scalar"
+
+struct VecD {
+	static constexpr int Lanes = 1;
+	double v;
+	VecD() {}
+	VecD(double value): v(value) {}
+	static VecD Broadcast(double value) { return value; }
+	static VecD Load(const double * ptr) { return * ptr; }
+	void Store(double * ptr) const { * ptr = v; }
+};
+struct MaskD {
+	bool m;
+	MaskD() {}
+	MaskD(bool value): m(value) {}
+	static MaskD All() { return true; }
+	static MaskD None() { return false; }
+};
+static inline VecD operator + (VecD a, VecD b) { return a.v + b.v; }
+static inline VecD operator - (VecD a, VecD b) { return a.v - b.v; }
+static inline VecD operator * (VecD a, VecD b) { return a.v * b.v; }
+static inline VecD Abs(VecD a) { return __builtin_fabs(a.v); }
+static inline MaskD operator > (VecD a, VecD b) { return a.v > b.v; }
+static inline MaskD operator < (VecD a, VecD b) { return a.v < b.v; }
+static inline MaskD operator & (MaskD a, MaskD b) { return a.m && b.m; }
+static inline MaskD operator | (MaskD a, MaskD b) { return a.m || b.m; }
+static inline MaskD AndNot(MaskD a, MaskD b) { return a.m && !b.m; }
+static inline VecD Select(MaskD mask, VecD a, VecD b) { return mask.m ? a : b; }
+static inline VecD MaskedAdd(VecD a, MaskD mask, VecD b) { return mask.m ? a.v + b.v : a.v; }
+static inline bool Any(MaskD mask) { return mask.m; }
+static inline int Bits(MaskD mask) { return mask.m ? 1 : 0; }
+
+struct VecI {
+	static constexpr int Lanes = 1;
+	int32_t v;
+	VecI() {}
+	VecI(int32_t value): v(value) {}
+	static VecI Broadcast(int32_t value) { return value; }
+	static VecI Load(const int32_t * ptr) { return * ptr; }
+	void Store(int32_t * ptr) const { * ptr = v; }
+};
+static inline VecI operator + (VecI a, VecI b) { return a.v + b.v; }
+static inline VecI operator - (VecI a, VecI b) { return a.v - b.v; }
+template < int Bits > static inline VecI ShiftLeft(VecI a) { return (int32_t) ((uint32_t) a.v << Bits); }
+template < int Bits > static inline VecI ShiftRight(VecI a) { return a.v >> Bits; }
+#endif
+
+#endif
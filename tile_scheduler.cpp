@@ -0,0 +1,179 @@
+#include "tile_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+std::vector < Tile > MakeTiles(int width, int height, int tileWidth, int tileHeight) {
+	std::vector < Tile > tiles;
+	for(int y0 = 0; y0 < height; y0 += tileHeight) {
+		for(int x0 = 0; x0 < width; x0 += tileWidth) {
+			tiles.push_back({x0, y0, std::min(x0 + tileWidth, width), std::min(y0 + tileHeight, height)});
+		}
+	}
+	return tiles;
+}
+
+TileScheduler::TileScheduler(unsigned threadCount): threadCount(threadCount) {
+	if(this->threadCount == 0) {
+		this->threadCount = std::thread::hardware_concurrency();
+	}
+	if(this->threadCount == 0) {
+		this->threadCount = 4;
+	}
+	queues = std::vector < WorkerQueue > (this->threadCount);
+	for(unsigned t = 1; t < this->threadCount; ++t) {
+		workers.emplace_back(&TileScheduler::ParkedWorker, this, t);
+	}
+}
+
+TileScheduler::~TileScheduler() {
+	{
+		std::lock_guard < std::mutex > lock(poolMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(auto & worker: workers) {
+		worker.join();
+	}
+}
+
+void TileScheduler::ParkedWorker(unsigned threadIndex) {
+	unsigned long long seenGeneration = 0;
+	while(true) {
+		const std::function < void(int, unsigned) > * task;
+		{
+			std::unique_lock < std::mutex > lock(poolMutex);
+			wake.wait(lock, [ & ] {
+				return stopping || generation != seenGeneration;
+			});
+			if(stopping) {
+				return;
+			}
+			seenGeneration = generation;
+			task = currentTask;
+		}
+		WorkerLoop(threadIndex, * task);
+		{
+			std::lock_guard < std::mutex > lock(poolMutex);
+			if(--pending == 0) {
+				done.notify_one();
+			}
+		}
+	}
+}
+
+bool TileScheduler::PopLocal(unsigned threadIndex, int & tile) {
+	WorkerQueue & queue = queues[threadIndex];
+	std::lock_guard < std::mutex > lock(queue.mutex);
+	if(queue.tiles.empty()) {
+		return false;
+	}
+	tile = queue.tiles.back();
+	queue.tiles.pop_back();
+	return true;
+}
+
+bool TileScheduler::Steal(unsigned threadIndex, int & tile) {
+	for(unsigned k = 1; k < threadCount; ++k) {
+		WorkerQueue & victim = queues[(threadIndex + k) % threadCount];
+		std::lock_guard < std::mutex > lock(victim.mutex);
+		if(!victim.tiles.empty()) {
+			tile = victim.tiles.front();
+			victim.tiles.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void TileScheduler::WorkerLoop(unsigned threadIndex, const std::function < void(int, unsigned) > & task) {
+	WorkerQueue & own = queues[threadIndex];
+	int tile;
+	while(true) {
+		bool stolen = false;
+		if(!PopLocal(threadIndex, tile)) {
+			// Nothing new is ever queued during a pass, so a failed steal
+			// means every tile has been claimed.
+			if(!Steal(threadIndex, tile)) {
+				break;
+			}
+			stolen = true;
+		}
+		auto start = std::chrono::steady_clock::now();
+		task(tile, threadIndex);
+		own.busySeconds += std::chrono::duration < double > (std::chrono::steady_clock::now() - start).count();
+		own.tilesDone++;
+		own.tilesStolen += stolen;
+	}
+}
+
+void TileScheduler::Run(int tileCount, const std::function < void(int, unsigned) > & task) {
+	auto start = std::chrono::steady_clock::now();
+	for(unsigned t = 0; t < threadCount; ++t) {
+		int first = (int) ((long long) tileCount * t / threadCount);
+		int last = (int) ((long long) tileCount * (t + 1) / threadCount);
+		std::lock_guard < std::mutex > lock(queues[t].mutex);
+		queues[t].tiles.clear();
+		// Owners pop from the back, so push in reverse to start at the top of their run.
+		for(int i = last - 1; i >= first; --i) {
+			queues[t].tiles.push_back(i);
+		}
+	}
+	{
+		std::lock_guard < std::mutex > lock(poolMutex);
+		currentTask = &task;
+		pending = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	WorkerLoop(0, task);
+	{
+		std::unique_lock < std::mutex > lock(poolMutex);
+		done.wait(lock, [ & ] {
+			return pending == 0;
+		});
+		currentTask = nullptr;
+	}
+	wallSeconds += std::chrono::duration < double > (std::chrono::steady_clock::now() - start).count();
+	passes++;
+}
+
+void TileScheduler::ResetStats() {
+	for(auto & queue: queues) {
+		queue.tilesDone = 0;
+		queue.tilesStolen = 0;
+		queue.busySeconds = 0.0;
+	}
+	wallSeconds = 0.0;
+	passes = 0;
+}
+
+double TileScheduler::Utilization() const {
+	double busySum = 0.0;
+	for(const auto & queue: queues) {
+		busySum += queue.busySeconds;
+	}
+	return wallSeconds > 0.0 ? busySum / (wallSeconds * threadCount) : 0.0;
+}
+
+std::string TileScheduler::LoadBalanceReport() const {
+	unsigned long long tiles = 0;
+	unsigned long long stolen = 0;
+	double busyMax = 0.0;
+	double busySum = 0.0;
+	for(const auto & queue: queues) {
+		tiles += queue.tilesDone;
+		stolen += queue.tilesStolen;
+		busyMax = std::max(busyMax, queue.busySeconds);
+		busySum += queue.busySeconds;
+	}
+	double busyMean = busySum / threadCount;
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(1);
+	report << "Load balance: " << threadCount << " threads, " << passes << " passes, " << tiles << " tiles (" << stolen << " stolen), ";
+	report << "busy mean " << busyMean * 1000.0 << " ms / max " << busyMax * 1000.0 << " ms (" << (busyMax > 0.0 ? 100.0 * busyMean / busyMax : 100.0) << "% balanced), ";
+	report << "utilization " << 100.0 * Utilization() << "%";
+	return report.str();
+}
@@ -0,0 +1,85 @@
+#ifndef _TILE_SCHEDULER_HPP_
+#define _TILE_SCHEDULER_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Rectangle of pixels [x0, x1) x [y0, y1) rendered as one unit of work.
+**/
+struct Tile {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+};
+
+/**
+ * Splits a width x height frame into tiles of at most tileWidth x tileHeight,
+ * row-major. tileWidth should be a multiple of 8 so that no two tiles share a
+ * byte of the 1bpp frame buffer.
+**/
+std::vector < Tile > MakeTiles(int width, int height, int tileWidth, int tileHeight);
+
+/**
+ * Work-stealing scheduler: tiles are dealt in contiguous runs to per-thread
+ * deques, each thread pops from the back of its own deque and, once empty,
+ * steals from the front of the others. Per-thread busy time is accumulated
+ * until ResetStats() so a whole frame (including retries) can be reported.
+ *
+ * The worker threads are started once and live as long as the scheduler.
+ * Between passes they block on a condition variable, so an idle scheduler
+ * costs no CPU time.
+**/
+class TileScheduler {
+	public: explicit TileScheduler(unsigned threadCount = 0);
+	~TileScheduler();
+	TileScheduler(const TileScheduler &) = delete;
+	TileScheduler & operator = (const TileScheduler &) = delete;
+	unsigned ThreadCount() const {
+		return threadCount;
+	};
+	/**
+	 * Calls task(tileIndex, threadIndex) once for every tile in [0, tileCount)
+	 * and returns when all of them are done. The calling thread takes part as
+	 * thread 0, so threadIndex is always below ThreadCount().
+	**/
+	void Run(int tileCount, const std::function < void(int, unsigned) > & task);
+	void ResetStats();
+	/**
+	 * Busy time of all threads over wall time times thread count, since
+	 * ResetStats().
+	**/
+	double Utilization() const;
+	std::string LoadBalanceReport() const;
+	private: struct alignas(64) WorkerQueue {
+		std::mutex mutex;
+		std::deque < int > tiles;
+		unsigned long long tilesDone = 0;
+		unsigned long long tilesStolen = 0;
+		double busySeconds = 0.0;
+	};
+	void ParkedWorker(unsigned threadIndex);
+	void WorkerLoop(unsigned threadIndex, const std::function < void(int, unsigned) > & task);
+	bool PopLocal(unsigned threadIndex, int & tile);
+	bool Steal(unsigned threadIndex, int & tile);
+	unsigned threadCount;
+	std::vector < WorkerQueue > queues;
+	std::vector < std::thread > workers;
+	std::mutex poolMutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function < void(int, unsigned) > * currentTask = nullptr;
+	unsigned long long generation = 0;
+	unsigned pending = 0;
+	bool stopping = false;
+	double wallSeconds = 0.0;
+	unsigned passes = 0;
+};
+
+#endif